@@ -37,10 +37,36 @@
   dbus_g_type_get_collection ("GPtrArray", \
                               PANEL_TYPE_DBUS_SET_PROPERTY)
 
+#define PANEL_TYPE_DBUS_PLUGIN_STATS \
+  dbus_g_type_get_struct ("GValueArray", \
+                          G_TYPE_STRING, \
+                          G_TYPE_INT, \
+                          G_TYPE_INT, \
+                          G_TYPE_UINT64, \
+                          G_TYPE_UINT64, \
+                          G_TYPE_UINT64, \
+                          G_TYPE_UINT64, \
+                          G_TYPE_INVALID)
+
+#define PANEL_TYPE_DBUS_STATS \
+  dbus_g_type_get_collection ("GPtrArray", \
+                              PANEL_TYPE_DBUS_PLUGIN_STATS)
+
 enum
 {
   DBUS_SET_TYPE,
   DBUS_SET_VALUE
 };
 
+enum
+{
+  DBUS_STATS_NAME,
+  DBUS_STATS_UNIQUE_ID,
+  DBUS_STATS_PID,
+  DBUS_STATS_CPU_TIME,
+  DBUS_STATS_RSS,
+  DBUS_STATS_WAKEUPS,
+  DBUS_STATS_MESSAGES
+};
+
 #endif /* !__PANEL_DBUS_H__ */
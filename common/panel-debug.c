@@ -41,6 +41,9 @@ static const GDebugKey panel_debug_keys[] =
   { "gdb", PANEL_DEBUG_GDB },
   { "valgrind", PANEL_DEBUG_VALGRIND },
 
+  /* main loop latency tracing */
+  { "latency", PANEL_DEBUG_LATENCY },
+
   /* domains for debug messages in the code */
   { "application", PANEL_DEBUG_APPLICATION },
   { "applicationsmenu", PANEL_DEBUG_APPLICATIONSMENU },
@@ -76,9 +79,10 @@ panel_debug_init (void)
           /* always enable (unfiltered) debugging messages */
           PANEL_SET_FLAG (panel_debug_flags, PANEL_DEBUG_YES);
 
-          /* unset gdb and valgrind in 'all' mode */
+          /* unset gdb, valgrind and tracing in 'all' mode */
           if (g_ascii_strcasecmp (value, "all") == 0)
-            PANEL_UNSET_FLAG (panel_debug_flags, PANEL_DEBUG_GDB | PANEL_DEBUG_VALGRIND);
+            PANEL_UNSET_FLAG (panel_debug_flags, PANEL_DEBUG_GDB | PANEL_DEBUG_VALGRIND
+                              | PANEL_DEBUG_LATENCY);
         }
 
       g_once_init_leave (&inited__volatile, 1);
@@ -201,3 +201,115 @@ panel_utils_set_atk_info (GtkWidget   *widget,
         atk_object_set_description (object, description);
     }
 }
+
+
+
+static void
+panel_utils_exec_append_quoted (GString     *string,
+                                const gchar *unquoted)
+{
+  gchar *quoted;
+
+  quoted = g_shell_quote (unquoted);
+  g_string_append (string, quoted);
+  g_free (quoted);
+}
+
+
+
+gboolean
+panel_utils_exec_parse (const gchar   *command,
+                        gboolean       requires_terminal,
+                        const gchar   *icon_name,
+                        const gchar   *name,
+                        const gchar   *uri,
+                        GSList        *uri_list,
+                        gchar       ***argv,
+                        GError       **error)
+{
+  GString     *string;
+  const gchar *p;
+  gboolean     result;
+  GSList      *li;
+  gchar       *filename;
+
+  panel_return_val_if_fail (!exo_str_is_empty (command), FALSE);
+
+  /* allocate an empty string */
+  string = g_string_sized_new (100);
+
+  /* prepend terminal command if required */
+  if (requires_terminal)
+    g_string_append (string, "exo-open --launch TerminalEmulator ");
+
+  for (p = command; *p != '\0'; ++p)
+    {
+      if (G_UNLIKELY (p[0] == '%' && p[1] != '\0'))
+        {
+          switch (*++p)
+            {
+            case 'f':
+            case 'F':
+              for (li = uri_list; li != NULL; li = li->next)
+                {
+                  filename = g_filename_from_uri ((const gchar *) li->data,
+                                                  NULL, NULL);
+                  if (G_LIKELY (filename != NULL))
+                    panel_utils_exec_append_quoted (string, filename);
+                  g_free (filename);
+
+                  if (*p == 'f')
+                    break;
+                  if (li->next != NULL)
+                    g_string_append_c (string, ' ');
+                }
+              break;
+
+            case 'u':
+            case 'U':
+              for (li = uri_list; li != NULL; li = li->next)
+                {
+                  panel_utils_exec_append_quoted (string, (const gchar *)
+                                                  li->data);
+
+                  if (*p == 'u')
+                    break;
+                  if (li->next != NULL)
+                    g_string_append_c (string, ' ');
+                }
+              break;
+
+            case 'i':
+              if (!exo_str_is_empty (icon_name))
+                {
+                  g_string_append (string, "--icon ");
+                  panel_utils_exec_append_quoted (string, icon_name);
+                }
+              break;
+
+            case 'c':
+              if (!exo_str_is_empty (name))
+                panel_utils_exec_append_quoted (string, name);
+              break;
+
+            case 'k':
+              if (!exo_str_is_empty (uri))
+                panel_utils_exec_append_quoted (string, uri);
+              break;
+
+            case '%':
+              g_string_append_c (string, '%');
+              break;
+            }
+        }
+      else
+        {
+          g_string_append_c (string, *p);
+        }
+    }
+
+  result = g_shell_parse_argv (string->str, NULL, argv, error);
+  g_string_free (string, TRUE);
+
+  return result;
+}
@@ -42,4 +42,13 @@ void        panel_utils_set_atk_info   (GtkWidget        *widget,
                                         const gchar      *name,
                                         const gchar      *description);
 
+gboolean    panel_utils_exec_parse     (const gchar      *command,
+                                        gboolean          requires_terminal,
+                                        const gchar      *icon_name,
+                                        const gchar      *name,
+                                        const gchar      *uri,
+                                        GSList           *uri_list,
+                                        gchar          ***argv,
+                                        GError          **error);
+
 #endif /* !__PANEL_BUILDER_H__ */
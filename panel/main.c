@@ -48,12 +48,15 @@
 #include <panel/panel-dbus-service.h>
 #include <panel/panel-dbus-client.h>
 #include <panel/panel-preferences-dialog.h>
+#include <panel/panel-stats.h>
+#include <panel/panel-trace.h>
 
 
 
 static gint       opt_preferences = -1;
 static gint       opt_add_items = -1;
 static gboolean   opt_save = FALSE;
+static gboolean   opt_stats = FALSE;
 static gchar     *opt_add = NULL;
 static gboolean   opt_restart = FALSE;
 static gboolean   opt_quit = FALSE;
@@ -79,6 +82,7 @@ static GOptionEntry option_entries[] =
   { "preferences", 'p', PANEL_CALLBACK_OPTION, N_("Show the 'Panel Preferences' dialog"), N_("PANEL-NUMBER") },
   { "add-items", 'a', PANEL_CALLBACK_OPTION, N_("Show the 'Add New Items' dialog"), N_("PANEL-NUMBER") },
   { "save", 's', 0, G_OPTION_ARG_NONE, &opt_save, N_("Save the panel configuration"), NULL },
+  { "stats", '\0', 0, G_OPTION_ARG_NONE, &opt_stats, N_("Print the resource usage of the plugins"), NULL },
   { "add", '\0', 0, G_OPTION_ARG_STRING, &opt_add, N_("Add a new plugin to the panel"), N_("PLUGIN-NAME") },
   { "restart", 'r', 0, G_OPTION_ARG_NONE, &opt_restart, N_("Restart the running panel instance"), NULL },
   { "quit", 'q', 0, G_OPTION_ARG_NONE, &opt_quit, N_("Quit the running panel instance"), NULL },
@@ -211,6 +215,13 @@ main (gint argc, gchar **argv)
   const gchar      *error_msg;
   XfceSMClient     *sm_client;
 
+#if !GLIB_CHECK_VERSION (2, 32, 0)
+  /* initialize the threading system, plugins like the applications
+   * menu parse files in a worker thread */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
   panel_debug (PANEL_DEBUG_MAIN,
                "version %s on gtk+ %d.%d.%d (%d.%d.%d), glib %d.%d.%d (%d.%d.%d)",
                LIBXFCE4PANEL_VERSION,
@@ -282,6 +293,12 @@ main (gint argc, gchar **argv)
       succeed = panel_dbus_client_save (&error);
       goto dbus_return;
     }
+  else if (opt_stats)
+    {
+      /* print the plugin statistics of the running instance */
+      succeed = panel_dbus_client_stats (&error);
+      goto dbus_return;
+    }
   else if (opt_add != NULL)
     {
       /* send a add-new-item signal to the running instance */
@@ -338,6 +355,13 @@ main (gint argc, gchar **argv)
   for (i = 0; i < G_N_ELEMENTS (signums); i++)
     signal (signums[i], panel_signal_handler);
 
+  /* account the event dispatching of the plugins */
+  panel_stats_start ();
+
+  /* opt-in tracing of the main loop latency */
+  if (panel_debug_has_domain (PANEL_DEBUG_LATENCY))
+    panel_trace_start ();
+
   application = panel_application_get ();
   panel_application_load (application, opt_disable_wm_check);
 
@@ -347,6 +371,9 @@ main (gint argc, gchar **argv)
 
   gtk_main ();
 
+  panel_trace_stop ();
+  panel_stats_stop ();
+
   /* make sure there are no incomming events when we close */
   g_object_unref (G_OBJECT (dbus_service));
 
@@ -379,6 +406,8 @@ dbus_return:
         error_msg = _("Failed to show the add new items dialog");
       else if (opt_save)
         error_msg = _("Failed to save the panel configuration");
+      else if (opt_stats)
+        error_msg = _("Failed to get the plugin statistics");
       else if (opt_add)
         error_msg = _("Failed to add a plugin to the panel");
       else if (opt_restart)
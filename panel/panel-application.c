@@ -69,6 +69,11 @@ static gboolean  panel_application_plugin_insert      (PanelApplication       *a
                                                        gint                    unique_id,
                                                        gchar                 **arguments,
                                                        gint                    position);
+static void      panel_application_window_reserve     (PanelApplication       *application,
+                                                       PanelWindow            *window,
+                                                       GPtrArray              *array);
+static void      panel_application_window_load_pending (PanelApplication      *application,
+                                                       PanelWindow            *window);
 static void      panel_application_dialog_destroyed   (GtkWindow              *dialog,
                                                        PanelApplication       *application);
 static void      panel_application_drag_data_received (PanelWindow            *window,
@@ -122,6 +127,9 @@ struct _PanelApplication
   /* internal list of all the panel windows */
   GSList             *windows;
 
+  /* plugin ids of hidden panels that are not loaded yet */
+  GHashTable         *pending_plugins;
+
   /* internal list of opened dialogs */
   GSList             *dialogs;
 
@@ -197,9 +205,12 @@ panel_application_init (PanelApplication *application)
 {
   GError *error = NULL;
   gint    configver;
+  gint    suspend_timeout;
 
   application->windows = NULL;
   application->dialogs = NULL;
+  application->pending_plugins = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                        NULL, (GDestroyNotify) xfconf_array_free);
   application->drop_desktop_files = FALSE;
   application->drop_data_ready = FALSE;
   application->drop_occurred = FALSE;
@@ -222,6 +233,11 @@ panel_application_init (PanelApplication *application)
   if (xfconf_channel_get_bool (application->xfconf, "/force-all-external", FALSE))
     panel_module_factory_force_all_external ();
 
+  /* check if external plugins on hidden panels should be stopped */
+  suspend_timeout = xfconf_channel_get_int (application->xfconf, "/suspend-hidden-plugins", 0);
+  if (suspend_timeout > 0)
+    panel_plugin_external_set_suspend_timeout (suspend_timeout);
+
   /* get a factory reference so it never unloads */
   application->factory = panel_module_factory_get ();
 
@@ -257,6 +273,8 @@ panel_application_finalize (GObject *object)
   g_slist_foreach (application->windows, (GFunc) gtk_widget_destroy, NULL);
   g_slist_free (application->windows);
 
+  g_hash_table_destroy (application->pending_plugins);
+
   g_object_unref (G_OBJECT (application->factory));
 
   /* this is a good reference if all the objects are released */
@@ -326,14 +344,130 @@ panel_application_xfconf_window_bindings (PanelApplication *application,
 
 
 
+static gboolean
+panel_application_load_plugins (PanelApplication *application,
+                                PanelWindow      *window,
+                                GPtrArray        *array)
+{
+  guint         j;
+  gchar         buf[50];
+  gchar        *name;
+  gint          unique_id;
+  const GValue *value;
+  gboolean      ids_changed = FALSE;
+
+  for (j = 0; j < array->len; j++)
+    {
+      /* get the plugin id */
+      value = g_ptr_array_index (array, j);
+      panel_assert (value != NULL);
+      unique_id = g_value_get_int (value);
+
+      /* get the plugin name */
+      g_snprintf (buf, sizeof (buf), "/plugins/plugin-%d", unique_id);
+      name = xfconf_channel_get_string (application->xfconf, buf, NULL);
+
+      /* append the plugin to the panel */
+      if (unique_id < 1 || name == NULL
+          || !panel_application_plugin_insert (application, window,
+                                               name, unique_id, NULL, -1))
+        {
+          /* plugin could not be loaded, remove it from the channel */
+          g_snprintf (buf, sizeof (buf), "/panels/plugin-%d", unique_id);
+          if (xfconf_channel_has_property (application->xfconf, buf))
+            xfconf_channel_reset_property (application->xfconf, buf, TRUE);
+
+          /* show warnings */
+          g_message ("Plugin \"%s-%d\" was not found and has been "
+                     "removed from the configuration", name, unique_id);
+
+          /* save configuration change after loading */
+          ids_changed = TRUE;
+        }
+
+      g_free (name);
+    }
+
+  return ids_changed;
+}
+
+
+
 static void
-panel_application_load_real (PanelApplication *application)
+panel_application_window_reserve (PanelApplication *application,
+                                  PanelWindow      *window,
+                                  GPtrArray        *array)
 {
-  PanelWindow  *window;
-  guint         i, j, n_panels;
+  guint         j;
   gchar         buf[50];
   gchar        *name;
   gint          unique_id;
+  const GValue *value;
+
+  /* reserve the ids and names of the deferred plugins in the factory,
+   * so new plugins do not steal their id or unique module */
+  for (j = 0; j < array->len; j++)
+    {
+      value = g_ptr_array_index (array, j);
+      panel_assert (value != NULL);
+      unique_id = g_value_get_int (value);
+
+      g_snprintf (buf, sizeof (buf), "/plugins/plugin-%d", unique_id);
+      name = xfconf_channel_get_string (application->xfconf, buf, NULL);
+
+      if (unique_id > 0 && name != NULL)
+        panel_module_factory_reserve_id (application->factory, name,
+                                         gtk_window_get_screen (GTK_WINDOW (window)),
+                                         unique_id);
+
+      g_free (name);
+    }
+}
+
+
+
+static void
+panel_application_window_load_pending (PanelApplication *application,
+                                       PanelWindow      *window)
+{
+  GPtrArray *array;
+  guint      j;
+
+  panel_return_if_fail (PANEL_IS_APPLICATION (application));
+  panel_return_if_fail (PANEL_IS_WINDOW (window));
+
+  /* steal the ids, so inserting the plugins does not end up here again */
+  array = g_hash_table_lookup (application->pending_plugins, window);
+  if (G_LIKELY (array == NULL))
+    return;
+  g_hash_table_steal (application->pending_plugins, window);
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (window),
+      G_CALLBACK (panel_application_window_load_pending), application);
+
+  panel_debug (PANEL_DEBUG_APPLICATION,
+               "loading %d deferred plugins of panel %d",
+               array->len, panel_window_get_id (window));
+
+  /* the plugins are created now, so release their reservation */
+  for (j = 0; j < array->len; j++)
+    panel_module_factory_release_id (application->factory,
+        g_value_get_int (g_ptr_array_index (array, j)));
+
+  if (panel_application_load_plugins (application, window, array))
+    panel_application_save_window (application, window, SAVE_PLUGIN_IDS);
+
+  xfconf_array_free (array);
+}
+
+
+
+static void
+panel_application_load_real (PanelApplication *application)
+{
+  PanelWindow  *window;
+  guint         i, n_panels;
+  gchar         buf[50];
   GdkScreen    *screen;
   GPtrArray    *array;
   const GValue *value;
@@ -344,12 +478,17 @@ panel_application_load_real (PanelApplication *application)
   GPtrArray    *panels;
   gint          panel_id;
   gboolean      save_changed_ids = FALSE;
+  gboolean      defer_hidden;
 
   panel_return_if_fail (PANEL_IS_APPLICATION (application));
   panel_return_if_fail (XFCONF_IS_CHANNEL (application->xfconf));
 
   display = gdk_display_get_default ();
 
+  /* whether plugins on hidden panels are loaded when the panel is shown */
+  defer_hidden = xfconf_channel_get_bool (application->xfconf,
+                                          "/defer-hidden-panels", FALSE);
+
   if (xfconf_channel_get_property (application->xfconf, "/panels", &val)
       && (G_VALUE_HOLDS_UINT (&val)
           || G_VALUE_HOLDS (&val, PANEL_PROPERTIES_TYPE_VALUE_ARRAY)))
@@ -405,38 +544,25 @@ panel_application_load_real (PanelApplication *application)
           if (array == NULL)
             continue;
 
-          for (j = 0; j < array->len; j++)
+          /* panels on an absent output are hidden, keep their plugin
+           * ids until the panel is shown */
+          if (defer_hidden
+              && !GTK_WIDGET_VISIBLE (window))
             {
-              /* get the plugin id */
-              value = g_ptr_array_index (array, j);
-              panel_assert (value != NULL);
-              unique_id = g_value_get_int (value);
-
-              /* get the plugin name */
-              g_snprintf (buf, sizeof (buf), "/plugins/plugin-%d", unique_id);
-              name = xfconf_channel_get_string (application->xfconf, buf, NULL);
-
-              /* append the plugin to the panel */
-              if (unique_id < 1 || name == NULL
-                  || !panel_application_plugin_insert (application, window,
-                                                       name, unique_id, NULL, -1))
-                {
-                  /* plugin could not be loaded, remove it from the channel */
-                  g_snprintf (buf, sizeof (buf), "/panels/plugin-%d", unique_id);
-                  if (xfconf_channel_has_property (application->xfconf, buf))
-                    xfconf_channel_reset_property (application->xfconf, buf, TRUE);
-
-                  /* show warnings */
-                  g_message ("Plugin \"%s-%d\" was not found and has been "
-                             "removed from the configuration", name, unique_id);
-
-                  /* save configuration change after loading */
-                  save_changed_ids = TRUE;
-                }
-
-              g_free (name);
+              panel_debug (PANEL_DEBUG_APPLICATION,
+                           "panel %d is hidden, deferring %d plugins",
+                           panel_id, array->len);
+
+              panel_application_window_reserve (application, window, array);
+              g_hash_table_insert (application->pending_plugins, window, array);
+              g_signal_connect_swapped (G_OBJECT (window), "show",
+                  G_CALLBACK (panel_application_window_load_pending), application);
+              continue;
             }
 
+          if (panel_application_load_plugins (application, window, array))
+            save_changed_ids = TRUE;
+
           xfconf_array_free (array);
         }
 
@@ -782,6 +908,9 @@ panel_application_plugin_insert (PanelApplication  *application,
   panel_return_val_if_fail (PANEL_IS_WINDOW (window), FALSE);
   panel_return_val_if_fail (name != NULL, FALSE);
 
+  /* load the deferred plugins first, so the order is preserved */
+  panel_application_window_load_pending (application, window);
+
   /* create a new panel plugin */
   provider = panel_module_factory_new_plugin (application->factory, name,
                                               gtk_window_get_screen (GTK_WINDOW (window)),
@@ -1298,9 +1427,11 @@ panel_application_save_window (PanelApplication *application,
   panel_return_if_fail (PANEL_IS_APPLICATION (application));
   panel_return_if_fail (PANEL_IS_WINDOW (window));
 
-  /* skip this window if it is locked */
+  /* skip this window if it is locked or its plugins are not loaded,
+   * the configuration of those is unchanged */
   if (panel_window_get_locked (window)
-      || !PANEL_HAS_FLAG (save_types, SAVE_PLUGIN_IDS | SAVE_PLUGIN_PROVIDERS))
+      || !PANEL_HAS_FLAG (save_types, SAVE_PLUGIN_IDS | SAVE_PLUGIN_PROVIDERS)
+      || g_hash_table_lookup (application->pending_plugins, window) != NULL)
     return;
 
   panel_id = panel_window_get_id (window);
@@ -1586,6 +1717,9 @@ panel_application_remove_window (PanelApplication *application,
                "removing configuration and plugins of panel %d",
                panel_id);
 
+  /* the plugins need to remove their configuration too */
+  panel_application_window_load_pending (application, window);
+
   /* remove from the internal list */
   application->windows = g_slist_remove (application->windows, window);
 
@@ -1650,6 +1784,10 @@ panel_application_window_select (PanelApplication *application,
 
   panel_return_if_fail (PANEL_IS_APPLICATION (application));
 
+  /* the preferences dialog shows the plugins of the selected window */
+  if (window != NULL)
+    panel_application_window_load_pending (application, window);
+
   /* update state for all windows */
   for (li = application->windows; li != NULL; li = li->next)
     g_object_set (G_OBJECT (li->data), "active", window == li->data, NULL);
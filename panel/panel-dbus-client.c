@@ -272,6 +272,81 @@ out:
 
 
 
+gboolean
+panel_dbus_client_stats (GError **error)
+{
+  DBusGProxy  *dbus_proxy;
+  GPtrArray   *stats = NULL;
+  gboolean     result;
+  guint        i;
+  GValue       message = { 0, };
+  gchar       *name;
+  gint         unique_id;
+  GPid         pid;
+  guint64      cpu_time, rss, wakeups, n_messages;
+  gchar       *unique_name;
+
+  panel_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  dbus_proxy = panel_dbus_client_get_proxy (error);
+  if (G_UNLIKELY (dbus_proxy == NULL))
+    return FALSE;
+
+  result = _panel_dbus_client_get_stats (dbus_proxy, &stats, error);
+  if (G_LIKELY (result))
+    {
+      g_print ("%-28s %8s %10s %10s %10s %10s\n", _("Plugin"), _("PID"),
+               _("CPU (ms)"), _("RSS (KiB)"), _("Wake-ups"), _("Messages"));
+
+      g_value_init (&message, PANEL_TYPE_DBUS_PLUGIN_STATS);
+
+      for (i = 0; i < stats->len; i++)
+        {
+          g_value_set_static_boxed (&message, g_ptr_array_index (stats, i));
+          dbus_g_type_struct_get (&message,
+                                  DBUS_STATS_NAME, &name,
+                                  DBUS_STATS_UNIQUE_ID, &unique_id,
+                                  DBUS_STATS_PID, &pid,
+                                  DBUS_STATS_CPU_TIME, &cpu_time,
+                                  DBUS_STATS_RSS, &rss,
+                                  DBUS_STATS_WAKEUPS, &wakeups,
+                                  DBUS_STATS_MESSAGES, &n_messages,
+                                  G_MAXUINT);
+
+          if (unique_id != -1)
+            unique_name = g_strdup_printf ("%s-%d", name, unique_id);
+          else
+            unique_name = g_strdup (name);
+
+          if (pid > 0)
+            g_print ("%-28s %8d %10" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT
+                     " %10" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT "\n",
+                     unique_name, pid, cpu_time, rss, wakeups, n_messages);
+          else
+            g_print ("%-28s %8s %10" G_GUINT64_FORMAT " %10s %10" G_GUINT64_FORMAT
+                     " %10" G_GUINT64_FORMAT "\n", unique_name, _("internal"),
+                     cpu_time, "-", wakeups, n_messages);
+
+          g_free (unique_name);
+          g_free (name);
+        }
+
+      g_value_unset (&message);
+
+      G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      for (i = 0; i < stats->len; i++)
+        g_value_array_free (g_ptr_array_index (stats, i));
+      G_GNUC_END_IGNORE_DEPRECATIONS
+      g_ptr_array_free (stats, TRUE);
+    }
+
+  g_object_unref (G_OBJECT (dbus_proxy));
+
+  return result;
+}
+
+
+
 gboolean
 panel_dbus_client_terminate (gboolean   restart,
                              GError   **error)
@@ -39,6 +39,8 @@ gboolean  panel_dbus_client_plugin_event               (const gchar  *plugin_eve
                                                         gboolean     *return_succeed,
                                                         GError      **error);
 
+gboolean  panel_dbus_client_stats                      (GError      **error);
+
 gboolean  panel_dbus_client_terminate                  (gboolean      restart,
                                                         GError      **error);
 
@@ -20,9 +20,15 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include <dbus/dbus.h>
 #include <dbus/dbus-glib.h>
@@ -39,6 +45,8 @@
 #include <panel/panel-preferences-dialog.h>
 #include <panel/panel-item-dialog.h>
 #include <panel/panel-module-factory.h>
+#include <panel/panel-plugin-external.h>
+#include <panel/panel-stats.h>
 
 
 
@@ -63,6 +71,9 @@ static gboolean  panel_dbus_service_plugin_event               (PanelDBusService
                                                                 const GValue      *value,
                                                                 gboolean          *OUT_succeed,
                                                                 GError           **error);
+static gboolean  panel_dbus_service_get_stats                  (PanelDBusService   *service,
+                                                                GPtrArray         **OUT_stats,
+                                                                GError            **error);
 static gboolean  panel_dbus_service_terminate                  (PanelDBusService   *service,
                                                                 gboolean            restart,
                                                                 GError            **error);
@@ -426,6 +437,159 @@ panel_dbus_service_plugin_event (PanelDBusService  *service,
 
 
 
+static void
+panel_dbus_service_stats_proc (GPid     pid,
+                               guint64 *cpu_time,
+                               guint64 *rss,
+                               guint64 *wakeups)
+{
+  gchar       *filename;
+  gchar       *contents;
+  const gchar *p;
+  guint64      utime, stime, pages;
+  guint64      voluntary = 0, nonvoluntary = 0;
+  glong        clk_tck, page_size;
+
+  *cpu_time = *rss = *wakeups = 0;
+
+  clk_tck = sysconf (_SC_CLK_TCK);
+  page_size = sysconf (_SC_PAGESIZE);
+
+  /* user and system time in clock ticks, the comm field can
+   * contain spaces so start parsing after the closing bracket */
+  filename = g_strdup_printf ("/proc/%d/stat", pid);
+  if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      p = strrchr (contents, ')');
+      if (p != NULL
+          && sscanf (p, ") %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %"
+                     G_GUINT64_FORMAT " %" G_GUINT64_FORMAT, &utime, &stime) == 2
+          && clk_tck > 0)
+        *cpu_time = (utime + stime) * 1000 / clk_tck;
+      g_free (contents);
+    }
+  g_free (filename);
+
+  /* resident set size in pages */
+  filename = g_strdup_printf ("/proc/%d/statm", pid);
+  if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      if (sscanf (contents, "%*u %" G_GUINT64_FORMAT, &pages) == 1
+          && page_size > 0)
+        *rss = pages * page_size / 1024;
+      g_free (contents);
+    }
+  g_free (filename);
+
+  /* each context switch is a wake-up of the process */
+  filename = g_strdup_printf ("/proc/%d/status", pid);
+  if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      p = strstr (contents, "\nvoluntary_ctxt_switches:");
+      if (p != NULL)
+        voluntary = g_ascii_strtoull (strchr (p, ':') + 1, NULL, 10);
+
+      p = strstr (contents, "\nnonvoluntary_ctxt_switches:");
+      if (p != NULL)
+        nonvoluntary = g_ascii_strtoull (strchr (p, ':') + 1, NULL, 10);
+
+      *wakeups = voluntary + nonvoluntary;
+      g_free (contents);
+    }
+  g_free (filename);
+}
+
+
+
+static void
+panel_dbus_service_stats_add (GPtrArray   *stats,
+                              const gchar *name,
+                              gint         unique_id,
+                              GPid         pid,
+                              guint64      cpu_time,
+                              guint64      wakeups,
+                              guint64      n_messages)
+{
+  GValue  message = { 0, };
+  guint64 rss = 0;
+
+  if (pid > 0)
+    panel_dbus_service_stats_proc (pid, &cpu_time, &rss, &wakeups);
+
+  g_value_init (&message, PANEL_TYPE_DBUS_PLUGIN_STATS);
+  g_value_take_boxed (&message, dbus_g_type_specialized_construct (G_VALUE_TYPE (&message)));
+
+  dbus_g_type_struct_set (&message,
+                          DBUS_STATS_NAME, name,
+                          DBUS_STATS_UNIQUE_ID, unique_id,
+                          DBUS_STATS_PID, pid,
+                          DBUS_STATS_CPU_TIME, cpu_time,
+                          DBUS_STATS_RSS, rss,
+                          DBUS_STATS_WAKEUPS, wakeups,
+                          DBUS_STATS_MESSAGES, n_messages,
+                          G_MAXUINT);
+
+  g_ptr_array_add (stats, g_value_dup_boxed (&message));
+  g_value_unset (&message);
+}
+
+
+
+static gboolean
+panel_dbus_service_get_stats (PanelDBusService  *service,
+                              GPtrArray        **OUT_stats,
+                              GError           **error)
+{
+  PanelModuleFactory *factory;
+  GSList             *plugins, *li;
+  GPid                pid;
+  guint64             cpu_time, wakeups, n_messages;
+
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+  panel_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  panel_return_val_if_fail (OUT_stats != NULL, FALSE);
+
+  *OUT_stats = g_ptr_array_new ();
+
+  /* the panel process, this includes all the internal plugins */
+  panel_dbus_service_stats_add (*OUT_stats, G_LOG_DOMAIN, -1, getpid (), 0, 0, 0);
+
+  factory = panel_module_factory_get ();
+  plugins = panel_module_factory_get_all_plugins (factory);
+
+  for (li = plugins; li != NULL; li = li->next)
+    {
+      panel_return_val_if_fail (XFCE_IS_PANEL_PLUGIN_PROVIDER (li->data), FALSE);
+
+      if (PANEL_IS_PLUGIN_EXTERNAL (li->data))
+        {
+          /* sampled from /proc */
+          pid = panel_plugin_external_get_pid (PANEL_PLUGIN_EXTERNAL (li->data));
+          n_messages = PANEL_PLUGIN_EXTERNAL (li->data)->n_messages;
+          cpu_time = wakeups = 0;
+        }
+      else
+        {
+          /* internal plugin, the time spent in its event handlers,
+           * the dispatched events and the emitted provider signals */
+          pid = 0;
+          panel_stats_get (li->data, &cpu_time, &wakeups, &n_messages);
+        }
+
+      panel_dbus_service_stats_add (*OUT_stats,
+          xfce_panel_plugin_provider_get_name (li->data),
+          xfce_panel_plugin_provider_get_unique_id (li->data),
+          pid, cpu_time, wakeups, n_messages);
+    }
+
+  g_slist_free (plugins);
+  g_object_unref (G_OBJECT (factory));
+
+  return TRUE;
+}
+
+
+
 static gboolean
 panel_dbus_service_terminate (PanelDBusService  *service,
                               gboolean           restart,
@@ -52,6 +52,7 @@ static gboolean panel_module_factory_modules_cleanup (gpointer
                                                       gpointer                  user_data);
 static void     panel_module_factory_remove_plugin   (gpointer                  user_data,
                                                       GObject                  *where_the_object_was);
+static void     panel_module_factory_reserved_free   (gpointer                  data);
 
 
 
@@ -76,10 +77,21 @@ struct _PanelModuleFactory
   /* all plugins in all windows */
   GSList     *plugins;
 
+  /* relation for unique id -> ReservedPlugin, for plugins
+   * in the configuration that are not created yet */
+  GHashTable *reserved;
+
   /* if the factory contains the launcher plugin */
   guint       has_launcher : 1;
 };
 
+typedef struct
+{
+  gchar     *name;
+  GdkScreen *screen;
+}
+ReservedPlugin;
+
 
 
 static guint    factory_signals[LAST_SIGNAL];
@@ -119,6 +131,8 @@ panel_module_factory_init (PanelModuleFactory *factory)
   factory->has_launcher = FALSE;
   factory->modules = g_hash_table_new_full (g_str_hash, g_str_equal,
                                             g_free, g_object_unref);
+  factory->reserved = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, panel_module_factory_reserved_free);
 
   /* load all the modules */
   panel_module_factory_load_modules (factory, TRUE);
@@ -132,6 +146,7 @@ panel_module_factory_finalize (GObject *object)
   PanelModuleFactory *factory = PANEL_MODULE_FACTORY (object);
 
   g_hash_table_destroy (factory->modules);
+  g_hash_table_destroy (factory->reserved);
   g_slist_free (factory->plugins);
 
   (*G_OBJECT_CLASS (panel_module_factory_parent_class)->finalize) (object);
@@ -270,12 +285,27 @@ panel_module_factory_remove_plugin (gpointer  user_data,
 
 
 
+static void
+panel_module_factory_reserved_free (gpointer data)
+{
+  ReservedPlugin *reserved = data;
+
+  g_free (reserved->name);
+  g_slice_free (ReservedPlugin, reserved);
+}
+
+
+
 static inline gboolean
 panel_module_factory_unique_id_exists (PanelModuleFactory *factory,
                                        gint                unique_id)
 {
   GSList *li;
 
+  /* ids of plugins that will be created later */
+  if (g_hash_table_lookup (factory->reserved, GINT_TO_POINTER (unique_id)) != NULL)
+    return TRUE;
+
   for (li = factory->plugins; li != NULL; li = li->next)
     if (xfce_panel_plugin_provider_get_unique_id (
         XFCE_PANEL_PLUGIN_PROVIDER (li->data)) == unique_id)
@@ -413,6 +443,73 @@ panel_module_factory_get_plugins (PanelModuleFactory *factory,
 
 
 
+GSList *
+panel_module_factory_get_all_plugins (PanelModuleFactory *factory)
+{
+  panel_return_val_if_fail (PANEL_IS_MODULE_FACTORY (factory), NULL);
+
+  return g_slist_copy (factory->plugins);
+}
+
+
+
+void
+panel_module_factory_reserve_id (PanelModuleFactory *factory,
+                                 const gchar        *name,
+                                 GdkScreen          *screen,
+                                 gint                unique_id)
+{
+  ReservedPlugin *reserved;
+
+  panel_return_if_fail (PANEL_IS_MODULE_FACTORY (factory));
+  panel_return_if_fail (GDK_IS_SCREEN (screen));
+  panel_return_if_fail (name != NULL);
+  panel_return_if_fail (unique_id > 0);
+
+  reserved = g_slice_new (ReservedPlugin);
+  reserved->name = g_strdup (name);
+  reserved->screen = screen;
+
+  g_hash_table_insert (factory->reserved, GINT_TO_POINTER (unique_id), reserved);
+}
+
+
+
+void
+panel_module_factory_release_id (PanelModuleFactory *factory,
+                                 gint                unique_id)
+{
+  panel_return_if_fail (PANEL_IS_MODULE_FACTORY (factory));
+
+  g_hash_table_remove (factory->reserved, GINT_TO_POINTER (unique_id));
+}
+
+
+
+gboolean
+panel_module_factory_is_reserved (PanelModuleFactory *factory,
+                                  const gchar        *name,
+                                  GdkScreen          *screen)
+{
+  GHashTableIter  iter;
+  ReservedPlugin *reserved;
+
+  panel_return_val_if_fail (PANEL_IS_MODULE_FACTORY (factory), FALSE);
+  panel_return_val_if_fail (name != NULL, FALSE);
+
+  /* whether a plugin with this name, optionally on this screen,
+   * is going to be created */
+  g_hash_table_iter_init (&iter, factory->reserved);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &reserved))
+    if (strcmp (reserved->name, name) == 0
+        && (screen == NULL || reserved->screen == screen))
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
 GtkWidget *
 panel_module_factory_new_plugin (PanelModuleFactory  *factory,
                                  const gchar         *name,
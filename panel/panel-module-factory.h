@@ -56,6 +56,20 @@ gboolean            panel_module_factory_has_module          (PanelModuleFactory
 GSList             *panel_module_factory_get_plugins         (PanelModuleFactory  *factory,
                                                               const gchar         *plugin_name);
 
+GSList             *panel_module_factory_get_all_plugins     (PanelModuleFactory  *factory);
+
+void                panel_module_factory_reserve_id          (PanelModuleFactory  *factory,
+                                                              const gchar         *name,
+                                                              GdkScreen           *screen,
+                                                              gint                 unique_id);
+
+void                panel_module_factory_release_id          (PanelModuleFactory  *factory,
+                                                              gint                 unique_id);
+
+gboolean            panel_module_factory_is_reserved         (PanelModuleFactory  *factory,
+                                                              const gchar         *name,
+                                                              GdkScreen           *screen);
+
 GtkWidget          *panel_module_factory_new_plugin          (PanelModuleFactory  *factory,
                                                               const gchar         *name,
                                                               GdkScreen           *screen,
@@ -622,6 +622,18 @@ panel_module_is_usable (PanelModule *module,
       && module->unique_mode == UNIQUE_TRUE)
     return FALSE;
 
+  if (module->unique_mode != UNIQUE_FALSE)
+    {
+      /* a plugin of a deferred panel will use the module later */
+      factory = panel_module_factory_get ();
+      usable = !panel_module_factory_is_reserved (factory, panel_module_get_name (module),
+          module->unique_mode == UNIQUE_SCREEN ? screen : NULL);
+      g_object_unref (G_OBJECT (factory));
+
+      if (!usable)
+        return FALSE;
+    }
+
   if (module->use_count > 0
       && module->unique_mode == UNIQUE_SCREEN)
     {
@@ -138,6 +138,7 @@ panel_plugin_external_46_client_event (GtkWidget      *widget,
   if (event->message_type == panel_atom)
     {
       provider_signal = event->data.s[0];
+      external->n_messages++;
 
       switch (provider_signal)
         {
@@ -297,6 +298,7 @@ panel_plugin_external_46_set_properties (PanelPluginExternal *external,
       window = gtk_socket_get_plug_window (GTK_SOCKET (external));
       panel_return_if_fail (GDK_IS_WINDOW (window));
       gdk_event_send_client_message ((GdkEvent *) &event, GDK_WINDOW_XID (window));
+      external->n_messages++;
     }
 
   bailout:
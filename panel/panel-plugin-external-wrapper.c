@@ -267,6 +267,8 @@ panel_plugin_external_wrapper_set_properties (PanelPluginExternal *external,
       g_ptr_array_add (array, g_value_dup_boxed (&message));
     }
 
+  PANEL_PLUGIN_EXTERNAL (external)->n_messages++;
+
   /* send array to the wrapper */
   g_signal_emit (G_OBJECT (external), external_signals[SET], 0, array);
 
@@ -306,6 +308,8 @@ panel_plugin_external_wrapper_remote_event (PanelPluginExternal *external,
       real_value = &dummy_value;
     }
 
+  PANEL_PLUGIN_EXTERNAL (external)->n_messages++;
+
   g_signal_emit (G_OBJECT (external), external_signals[REMOTE_EVENT], 0,
                  name, real_value, *handle);
 
@@ -325,6 +329,8 @@ panel_plugin_external_wrapper_dbus_provider_signal (PanelPluginExternalWrapper
   panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external), FALSE);
   panel_return_val_if_fail (XFCE_IS_PANEL_PLUGIN_PROVIDER (external), FALSE);
 
+  PANEL_PLUGIN_EXTERNAL (external)->n_messages++;
+
   switch (provider_signal)
     {
     case PROVIDER_SIGNAL_SHOW_CONFIGURE:
@@ -355,6 +361,8 @@ panel_plugin_external_wrapper_dbus_remote_event_result (PanelPluginExternalWrapp
 {
   panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external), FALSE);
 
+  PANEL_PLUGIN_EXTERNAL (external)->n_messages++;
+
   g_signal_emit (G_OBJECT (external), external_signals[REMOTE_EVENT_RESULT], 0,
                  handle, result);
 
@@ -64,6 +64,8 @@ static void         panel_plugin_external_set_property            (GObject
                                                                    GParamSpec                       *pspec);
 static void         panel_plugin_external_realize                 (GtkWidget                        *widget);
 static void         panel_plugin_external_unrealize               (GtkWidget                        *widget);
+static void         panel_plugin_external_map                     (GtkWidget                        *widget);
+static void         panel_plugin_external_unmap                   (GtkWidget                        *widget);
 static void         panel_plugin_external_plug_added              (GtkSocket                        *socket);
 static gboolean     panel_plugin_external_plug_removed            (GtkSocket                        *socket);
 static gboolean     panel_plugin_external_child_ask_restart       (PanelPluginExternal              *external);
@@ -126,6 +128,10 @@ struct _PanelPluginExternalPrivate
 
   /* delayed spawning */
   guint       spawn_timeout_id;
+
+  /* child stopped while the panel is hidden */
+  guint       suspend_timeout_id;
+  guint       suspended : 1;
 };
 
 enum
@@ -138,6 +144,11 @@ enum
 
 
 
+/* seconds a plugin can be hidden before the child is stopped, 0 disables */
+static guint suspend_timeout = 0;
+
+
+
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (PanelPluginExternal, panel_plugin_external, GTK_TYPE_SOCKET,
   G_IMPLEMENT_INTERFACE (XFCE_TYPE_PANEL_PLUGIN_PROVIDER, panel_plugin_external_provider_init))
 
@@ -160,6 +171,8 @@ panel_plugin_external_class_init (PanelPluginExternalClass *klass)
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->realize = panel_plugin_external_realize;
   gtkwidget_class->unrealize = panel_plugin_external_unrealize;
+  gtkwidget_class->map = panel_plugin_external_map;
+  gtkwidget_class->unmap = panel_plugin_external_unmap;
 
   gtksocket_class = GTK_SOCKET_CLASS (klass);
   gtksocket_class->plug_added = panel_plugin_external_plug_added;
@@ -201,6 +214,7 @@ panel_plugin_external_init (PanelPluginExternal *external)
   external->show_configure = FALSE;
   external->show_about = FALSE;
   external->unique_id = -1;
+  external->n_messages = 0;
 
   external->priv->arguments = NULL;
   external->priv->queue = NULL;
@@ -208,6 +222,8 @@ panel_plugin_external_init (PanelPluginExternal *external)
   external->priv->embedded = FALSE;
   external->priv->pid = 0;
   external->priv->spawn_timeout_id = 0;
+  external->priv->suspend_timeout_id = 0;
+  external->priv->suspended = FALSE;
 
   /* signal to pass gtk_widget_set_sensitive() changes to the remote window */
   g_signal_connect (G_OBJECT (external), "notify::sensitive",
@@ -246,6 +262,9 @@ panel_plugin_external_finalize (GObject *object)
   if (external->priv->spawn_timeout_id != 0)
     g_source_remove (external->priv->spawn_timeout_id);
 
+  if (external->priv->suspend_timeout_id != 0)
+    g_source_remove (external->priv->suspend_timeout_id);
+
   if (external->priv->watch_id != 0)
     {
       /* remove the child watch and don't leave zombies */
@@ -358,6 +377,11 @@ panel_plugin_external_unrealize (GtkWidget *widget)
 {
   PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (widget);
 
+  /* realize spawns a new child */
+  if (external->priv->suspend_timeout_id != 0)
+    g_source_remove (external->priv->suspend_timeout_id);
+  external->priv->suspended = FALSE;
+
   /* ask the child to quit */
   if (external->priv->pid != 0)
     {
@@ -377,6 +401,88 @@ panel_plugin_external_unrealize (GtkWidget *widget)
 
 
 
+static gboolean
+panel_plugin_external_child_suspend (gpointer user_data)
+{
+  PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (user_data);
+
+  panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external), FALSE);
+
+  if (external->priv->pid != 0
+      && external->priv->embedded)
+    {
+      panel_debug (PANEL_DEBUG_EXTERNAL,
+                   "%s-%d: hidden for %d seconds; suspending child",
+                   panel_module_get_name (external->module),
+                   external->unique_id, suspend_timeout);
+
+      /* the child saves and quits normally, the child watch
+       * will not restart it */
+      external->priv->suspended = TRUE;
+      panel_plugin_external_queue_add_action (external, PROVIDER_PROP_TYPE_ACTION_SAVE);
+      panel_plugin_external_queue_add_action (external, PROVIDER_PROP_TYPE_ACTION_QUIT);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+panel_plugin_external_child_suspend_destroyed (gpointer user_data)
+{
+  PANEL_PLUGIN_EXTERNAL (user_data)->priv->suspend_timeout_id = 0;
+}
+
+
+
+static void
+panel_plugin_external_map (GtkWidget *widget)
+{
+  PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (widget);
+
+  (*GTK_WIDGET_CLASS (panel_plugin_external_parent_class)->map) (widget);
+
+  if (external->priv->suspend_timeout_id != 0)
+    g_source_remove (external->priv->suspend_timeout_id);
+
+  /* restore a child that was stopped while hidden */
+  if (external->priv->suspended)
+    {
+      external->priv->suspended = FALSE;
+
+      panel_debug (PANEL_DEBUG_EXTERNAL,
+                   "%s-%d: plugin visible again; resuming child",
+                   panel_module_get_name (external->module),
+                   external->unique_id);
+
+      panel_plugin_external_child_respawn_schedule (external);
+    }
+}
+
+
+
+static void
+panel_plugin_external_unmap (GtkWidget *widget)
+{
+  PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (widget);
+
+  /* stop the child if the plugin stays hidden */
+  if (suspend_timeout > 0
+      && external->priv->pid != 0
+      && external->priv->suspend_timeout_id == 0)
+    {
+      external->priv->suspend_timeout_id =
+          g_timeout_add_seconds_full (G_PRIORITY_LOW, suspend_timeout,
+                                      panel_plugin_external_child_suspend, external,
+                                      panel_plugin_external_child_suspend_destroyed);
+    }
+
+  (*GTK_WIDGET_CLASS (panel_plugin_external_parent_class)->unmap) (widget);
+}
+
+
+
 static void
 panel_plugin_external_plug_added (GtkSocket *socket)
 {
@@ -638,8 +744,9 @@ panel_plugin_external_child_respawn (gpointer user_data)
 
   panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external), FALSE);
 
-  /* abort startup if the plugin is not realized */
-  if (!GTK_WIDGET_REALIZED (external))
+  /* abort startup if the plugin is not realized or was hidden again */
+  if (!GTK_WIDGET_REALIZED (external)
+      || external->priv->suspended)
     return FALSE;
 
   /* delay startup if the old child is still embedded */
@@ -1203,3 +1310,15 @@ panel_plugin_external_get_pid (PanelPluginExternal *external)
   panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external), 0);
   return external->priv->pid;
 }
+
+
+
+void
+panel_plugin_external_set_suspend_timeout (guint seconds)
+{
+  suspend_timeout = seconds;
+
+  panel_debug (PANEL_DEBUG_EXTERNAL,
+               "suspending plugins hidden for %d seconds",
+               seconds);
+}
@@ -66,6 +66,9 @@ struct _PanelPluginExternal
 
   gint                        unique_id;
 
+  /* number of messages exchanged with the plugin, for statistics */
+  guint64                     n_messages;
+
   /* some info received on plugin startup by the
    * implementations of the abstract object */
   guint                       show_configure : 1;
@@ -96,6 +99,8 @@ void         panel_plugin_external_set_background_image (PanelPluginExternal  *e
 
 GPid         panel_plugin_external_get_pid              (PanelPluginExternal  *external);
 
+void         panel_plugin_external_set_suspend_timeout  (guint                 seconds);
+
 G_END_DECLS
 
 #endif /* !__PANEL_PLUGIN_EXTERNAL_H__ */
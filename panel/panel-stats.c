@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2026 The Xfce development team <xfce4-dev@xfce.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <common/panel-private.h>
+#include <libxfce4panel/libxfce4panel.h>
+#include <libxfce4panel/xfce-panel-plugin-provider.h>
+
+#include <panel/panel-stats.h>
+#include <panel/panel-window.h>
+
+
+
+typedef struct
+{
+  /* seconds spent in the event handlers of the provider */
+  gdouble dispatch_time;
+  guint64 n_events;
+
+  /* provider signals emitted to the panel */
+  guint64 n_signals;
+}
+PanelStatsCounters;
+
+
+
+static gboolean panel_stats_provider_signal (GSignalInvocationHint *ihint,
+                                             guint                  n_param_values,
+                                             const GValue          *param_values,
+                                             gpointer               data);
+
+
+
+static GTimer *stats_timer = NULL;
+static GQuark  stats_quark = 0;
+static gulong  stats_provider_signal_hook = 0;
+static guint   stats_provider_signal_id = 0;
+
+
+
+static void
+panel_stats_counters_free (gpointer data)
+{
+  g_slice_free (PanelStatsCounters, data);
+}
+
+
+
+static PanelStatsCounters *
+panel_stats_counters (GObject *provider)
+{
+  PanelStatsCounters *counters;
+
+  counters = g_object_get_qdata (provider, stats_quark);
+  if (G_UNLIKELY (counters == NULL))
+    {
+      counters = g_slice_new0 (PanelStatsCounters);
+      g_object_set_qdata_full (provider, stats_quark, counters,
+                               panel_stats_counters_free);
+    }
+
+  return counters;
+}
+
+
+
+static GObject *
+panel_stats_provider (GtkWidget *widget)
+{
+  GtkWidget *parent;
+
+  /* walk up to the plugin that owns the widget */
+  for (parent = widget; parent != NULL; parent = gtk_widget_get_parent (parent))
+    {
+      if (XFCE_IS_PANEL_PLUGIN_PROVIDER (parent))
+        return G_OBJECT (parent);
+
+      if (PANEL_IS_WINDOW (parent))
+        break;
+    }
+
+  return NULL;
+}
+
+
+
+static gboolean
+panel_stats_provider_signal (GSignalInvocationHint *ihint,
+                             guint                  n_param_values,
+                             const GValue          *param_values,
+                             gpointer               data)
+{
+  panel_stats_counters (g_value_get_object (param_values))->n_signals++;
+
+  return TRUE;
+}
+
+
+
+void
+panel_stats_event (GdkEvent *event,
+                   gpointer  data)
+{
+  GObject            *provider;
+  PanelStatsCounters *counters;
+  gdouble             start;
+
+  provider = panel_stats_provider (gtk_get_event_widget (event));
+  if (provider == NULL)
+    {
+      gtk_main_do_event (event);
+      return;
+    }
+
+  /* the handler can destroy the plugin, keep the counters alive */
+  g_object_ref (provider);
+
+  start = g_timer_elapsed (stats_timer, NULL);
+  gtk_main_do_event (event);
+
+  counters = panel_stats_counters (provider);
+  counters->dispatch_time += g_timer_elapsed (stats_timer, NULL) - start;
+  counters->n_events++;
+
+  g_object_unref (provider);
+}
+
+
+
+void
+panel_stats_start (void)
+{
+  gpointer iface;
+
+  panel_return_if_fail (stats_timer == NULL);
+
+  stats_timer = g_timer_new ();
+  stats_quark = g_quark_from_static_string ("panel-stats-counters");
+
+  /* time the gdk events of each plugin, internal plugins share
+   * the main loop of the panel so this is where their cost is */
+  gdk_event_handler_set (panel_stats_event, NULL, NULL);
+
+  iface = g_type_default_interface_ref (XFCE_TYPE_PANEL_PLUGIN_PROVIDER);
+  stats_provider_signal_id = g_signal_lookup ("provider-signal", XFCE_TYPE_PANEL_PLUGIN_PROVIDER);
+  stats_provider_signal_hook = g_signal_add_emission_hook (stats_provider_signal_id, 0,
+      panel_stats_provider_signal, NULL, NULL);
+  g_type_default_interface_unref (iface);
+}
+
+
+
+void
+panel_stats_stop (void)
+{
+  if (stats_timer == NULL)
+    return;
+
+  g_signal_remove_emission_hook (stats_provider_signal_id, stats_provider_signal_hook);
+  gdk_event_handler_set ((GdkEventFunc) gtk_main_do_event, NULL, NULL);
+
+  g_timer_destroy (stats_timer);
+  stats_timer = NULL;
+}
+
+
+
+void
+panel_stats_get (XfcePanelPluginProvider *provider,
+                 guint64                 *dispatch_time,
+                 guint64                 *n_events,
+                 guint64                 *n_signals)
+{
+  PanelStatsCounters *counters = NULL;
+
+  panel_return_if_fail (XFCE_IS_PANEL_PLUGIN_PROVIDER (provider));
+
+  if (stats_quark != 0)
+    counters = g_object_get_qdata (G_OBJECT (provider), stats_quark);
+
+  /* dispatch time in milliseconds, like the cpu time */
+  *dispatch_time = counters != NULL ? counters->dispatch_time * 1000 : 0;
+  *n_events = counters != NULL ? counters->n_events : 0;
+  *n_signals = counters != NULL ? counters->n_signals : 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2026 The Xfce development team <xfce4-dev@xfce.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <common/panel-private.h>
+#include <common/panel-debug.h>
+#include <libxfce4panel/libxfce4panel.h>
+#include <libxfce4panel/xfce-panel-plugin-provider.h>
+
+#include <panel/panel-stats.h>
+#include <panel/panel-trace.h>
+#include <panel/panel-window.h>
+
+
+
+/* main loop iterations longer then this (in ms) are reported */
+#define STALL_THRESHOLD (100.00)
+
+/* the trace file is rotated when it grows larger then this */
+#define TRACE_MAX_SIZE  (32 * 1024 * 1024)
+
+/* interval (in ms) between flushes of the trace file */
+#define FLUSH_INTERVAL  (1000.00)
+
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW      (0)
+#endif
+
+
+
+static gint     panel_trace_poll            (GPollFD               *ufds,
+                                             guint                  nfds,
+                                             gint                   timeout);
+static void     panel_trace_event           (GdkEvent              *event,
+                                             gpointer               data);
+static gboolean panel_trace_size_allocate   (GSignalInvocationHint *ihint,
+                                             guint                  n_param_values,
+                                             const GValue          *param_values,
+                                             gpointer               data);
+static gboolean panel_trace_provider_signal (GSignalInvocationHint *ihint,
+                                             guint                  n_param_values,
+                                             const GValue          *param_values,
+                                             gpointer               data);
+
+
+
+/* trace-event json file, see the chrome://tracing documentation */
+static FILE       *trace_file = NULL;
+static gchar      *trace_filename = NULL;
+static gsize       trace_size = 0;
+static gdouble     trace_flushed = 0.00;
+static GTimer     *trace_timer = NULL;
+static GPollFunc   trace_poll_func = NULL;
+static GEnumClass *trace_event_types = NULL;
+static gboolean    trace_first_event = TRUE;
+
+/* emission hooks */
+static gulong      trace_size_allocate_hook = 0;
+static gulong      trace_provider_signal_hook = 0;
+static guint       trace_size_allocate_id = 0;
+static guint       trace_provider_signal_id = 0;
+
+/* start of the main loop dispatch in usec, -1 while polling */
+static gdouble     trace_dispatch_start = -1.00;
+
+/* most expensive owner during the current dispatch */
+static gchar      *trace_slowest_owner = NULL;
+static gdouble     trace_slowest_duration = 0.00;
+
+
+
+static gdouble
+panel_trace_now (void)
+{
+  return g_timer_elapsed (trace_timer, NULL) * G_USEC_PER_SEC;
+}
+
+
+
+static gchar *
+panel_trace_owner (GtkWidget *widget)
+{
+  GtkWidget *parent;
+
+  if (widget == NULL)
+    return g_strdup ("gdk");
+
+  /* walk up to the plugin or panel that owns the widget */
+  for (parent = widget; parent != NULL; parent = gtk_widget_get_parent (parent))
+    {
+      if (XFCE_IS_PANEL_PLUGIN_PROVIDER (parent))
+        return g_strdup_printf ("%s-%d",
+            xfce_panel_plugin_provider_get_name (XFCE_PANEL_PLUGIN_PROVIDER (parent)),
+            xfce_panel_plugin_provider_get_unique_id (XFCE_PANEL_PLUGIN_PROVIDER (parent)));
+
+      if (PANEL_IS_WINDOW (parent))
+        return g_strdup ("panel");
+    }
+
+  /* some other subsystem, like a dialog or menu */
+  return g_strdup (G_OBJECT_TYPE_NAME (widget));
+}
+
+
+
+static void
+panel_trace_write (const gchar *name,
+                   const gchar *category,
+                   gchar        phase,
+                   gdouble      timestamp,
+                   gdouble      duration)
+{
+  gchar *escaped;
+  gint   n;
+
+  escaped = g_strescape (name, NULL);
+
+  /* comma separate the events in the array */
+  if (!trace_first_event)
+    fputs (",\n", trace_file);
+  trace_first_event = FALSE;
+
+  if (phase == 'X')
+    n = fprintf (trace_file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                 "\"ts\":%.0f,\"dur\":%.0f,\"pid\":%d,\"tid\":1}",
+                 escaped, category, timestamp, duration, getpid ());
+  else
+    n = fprintf (trace_file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\","
+                 "\"ts\":%.0f,\"s\":\"t\",\"pid\":%d,\"tid\":1}",
+                 escaped, category, timestamp, getpid ());
+
+  if (n > 0)
+    trace_size += n + 2;
+
+  g_free (escaped);
+}
+
+
+
+static gboolean
+panel_trace_open (void)
+{
+  gint fd;
+
+  panel_return_val_if_fail (trace_file == NULL, FALSE);
+
+  /* the file is in the private cache directory of the user, never
+   * follow a link to another file someone put there */
+  fd = g_open (trace_filename, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+  if (fd != -1)
+    trace_file = fdopen (fd, "w");
+
+  if (G_UNLIKELY (trace_file == NULL))
+    {
+      if (fd != -1)
+        close (fd);
+
+      g_warning ("Failed to open the trace file %s", trace_filename);
+      return FALSE;
+    }
+
+  fputs ("[\n", trace_file);
+  trace_first_event = TRUE;
+  trace_size = 0;
+
+  return TRUE;
+}
+
+
+
+static void
+panel_trace_close (void)
+{
+  if (trace_file == NULL)
+    return;
+
+  fputs ("\n]\n", trace_file);
+  fclose (trace_file);
+  trace_file = NULL;
+}
+
+
+
+static void
+panel_trace_rotate (void)
+{
+  gchar *old_filename;
+
+  /* keep the previous part, so the trace never uses more then
+   * twice the maximum size */
+  panel_trace_close ();
+
+  old_filename = g_strconcat (trace_filename, ".old", NULL);
+  if (g_rename (trace_filename, old_filename) == -1)
+    g_warning ("Failed to rotate the trace file %s", trace_filename);
+  g_free (old_filename);
+
+  if (!panel_trace_open ())
+    panel_trace_stop ();
+}
+
+
+
+static gint
+panel_trace_poll (GPollFD *ufds,
+                  guint    nfds,
+                  gint     timeout)
+{
+  gdouble    now, duration;
+  gint       result;
+  GPollFunc  poll_func = trace_poll_func;
+
+  if (trace_dispatch_start >= 0.00)
+    {
+      /* everything between two polls is dispatching sources */
+      now = panel_trace_now ();
+      duration = now - trace_dispatch_start;
+      panel_trace_write ("dispatch", "main-loop", 'X', trace_dispatch_start, duration);
+
+      if (duration >= STALL_THRESHOLD * 1000.00)
+        {
+          panel_debug (PANEL_DEBUG_LATENCY,
+                       "main loop stalled for %.0f ms, most time spent in %s (%.0f ms)",
+                       duration / 1000.00,
+                       trace_slowest_owner != NULL ? trace_slowest_owner : "a source",
+                       trace_slowest_duration / 1000.00);
+          fflush (trace_file);
+          trace_flushed = now;
+        }
+
+      g_free (trace_slowest_owner);
+      trace_slowest_owner = NULL;
+      trace_slowest_duration = 0.00;
+
+      if (G_UNLIKELY (trace_size > TRACE_MAX_SIZE))
+        panel_trace_rotate ();
+      else if (now - trace_flushed >= FLUSH_INTERVAL * 1000.00)
+        {
+          fflush (trace_file);
+          trace_flushed = now;
+        }
+    }
+
+  result = (*poll_func) (ufds, nfds, timeout);
+
+  /* tracing stops if the file could not be rotated */
+  if (G_LIKELY (trace_file != NULL))
+    trace_dispatch_start = panel_trace_now ();
+
+  return result;
+}
+
+
+
+static void
+panel_trace_event (GdkEvent *event,
+                   gpointer  data)
+{
+  gdouble     start, duration;
+  gchar      *owner, *name;
+  GEnumValue *type;
+
+  /* attribute the event to the plugin or subsystem, before the
+   * event handler possibly destroys the widget */
+  owner = panel_trace_owner (gtk_get_event_widget (event));
+
+  start = panel_trace_now ();
+  panel_stats_event (event, NULL);
+  duration = panel_trace_now () - start;
+
+  type = g_enum_get_value (trace_event_types, event->type);
+  name = g_strdup_printf ("%s %s", type != NULL ? type->value_nick : "event", owner);
+  panel_trace_write (name, "event", 'X', start, duration);
+  g_free (name);
+
+  if (duration > trace_slowest_duration)
+    {
+      g_free (trace_slowest_owner);
+      trace_slowest_owner = owner;
+      trace_slowest_duration = duration;
+    }
+  else
+    {
+      g_free (owner);
+    }
+}
+
+
+
+static gboolean
+panel_trace_size_allocate (GSignalInvocationHint *ihint,
+                           guint                  n_param_values,
+                           const GValue          *param_values,
+                           gpointer               data)
+{
+  gchar *owner;
+
+  owner = panel_trace_owner (g_value_get_object (param_values));
+  panel_trace_write (owner, "size-allocate", 'i', panel_trace_now (), 0.00);
+  g_free (owner);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+panel_trace_provider_signal (GSignalInvocationHint *ihint,
+                             guint                  n_param_values,
+                             const GValue          *param_values,
+                             gpointer               data)
+{
+  gchar *owner, *name;
+
+  owner = panel_trace_owner (g_value_get_object (param_values));
+  name = g_strdup_printf ("%s signal %u", owner, g_value_get_uint (param_values + 1));
+  panel_trace_write (name, "provider-signal", 'i', panel_trace_now (), 0.00);
+  g_free (name);
+  g_free (owner);
+
+  return TRUE;
+}
+
+
+
+void
+panel_trace_start (void)
+{
+  gchar    *dirname;
+  gpointer  iface;
+
+  panel_return_if_fail (trace_timer == NULL);
+
+  /* write in the cache directory of the user, not in a shared
+   * temporary directory where the file name is predictable */
+  dirname = g_build_filename (g_get_user_cache_dir (), "xfce4", "panel", NULL);
+  g_mkdir_with_parents (dirname, 0700);
+  trace_filename = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "trace-%d.json",
+                                    dirname, getpid ());
+  g_free (dirname);
+
+  if (!panel_trace_open ())
+    {
+      g_free (trace_filename);
+      trace_filename = NULL;
+      return;
+    }
+
+  panel_debug (PANEL_DEBUG_LATENCY, "writing main loop trace to %s", trace_filename);
+
+  trace_timer = g_timer_new ();
+  trace_flushed = 0.00;
+  trace_event_types = g_type_class_ref (GDK_TYPE_EVENT_TYPE);
+
+  /* time the dispatching of each main loop iteration */
+  trace_poll_func = g_main_context_get_poll_func (NULL);
+  g_main_context_set_poll_func (NULL, panel_trace_poll);
+
+  /* time each gdk event, including expose events */
+  gdk_event_handler_set (panel_trace_event, NULL, NULL);
+
+  /* mark size allocations and provider signals */
+  trace_size_allocate_id = g_signal_lookup ("size-allocate", GTK_TYPE_WIDGET);
+  trace_size_allocate_hook = g_signal_add_emission_hook (trace_size_allocate_id, 0,
+      panel_trace_size_allocate, NULL, NULL);
+
+  iface = g_type_default_interface_ref (XFCE_TYPE_PANEL_PLUGIN_PROVIDER);
+  trace_provider_signal_id = g_signal_lookup ("provider-signal", XFCE_TYPE_PANEL_PLUGIN_PROVIDER);
+  trace_provider_signal_hook = g_signal_add_emission_hook (trace_provider_signal_id, 0,
+      panel_trace_provider_signal, NULL, NULL);
+  g_type_default_interface_unref (iface);
+}
+
+
+
+void
+panel_trace_stop (void)
+{
+  if (trace_timer == NULL)
+    return;
+
+  g_signal_remove_emission_hook (trace_size_allocate_id, trace_size_allocate_hook);
+  g_signal_remove_emission_hook (trace_provider_signal_id, trace_provider_signal_hook);
+
+  /* hand the events back to the statistics */
+  gdk_event_handler_set (panel_stats_event, NULL, NULL);
+  g_main_context_set_poll_func (NULL, trace_poll_func);
+
+  panel_trace_close ();
+  g_free (trace_filename);
+  trace_filename = NULL;
+
+  g_type_class_unref (trace_event_types);
+  g_timer_destroy (trace_timer);
+  trace_timer = NULL;
+  g_free (trace_slowest_owner);
+  trace_slowest_owner = NULL;
+  trace_dispatch_start = -1.00;
+}
@@ -39,6 +39,7 @@
 
 #define DEFAULT_ICON_SIZE (16)
 #define DEFAULT_TIMEOUT   (30)
+#define SESSION_NAME      "org.xfce.SessionManager"
 
 
 
@@ -61,6 +62,9 @@ static void       actions_plugin_pack                (ActionsPlugin         *plu
 static GPtrArray *actions_plugin_default_array       (void);
 static void       actions_plugin_menu                (GtkWidget             *button,
                                                       ActionsPlugin         *plugin);
+static void       actions_plugin_capabilities_init   (ActionsPlugin         *plugin);
+static void       actions_plugin_capabilities_free   (ActionsPlugin         *plugin);
+static void       actions_plugin_capabilities_path   (ActionsPlugin         *plugin);
 
 
 
@@ -103,6 +107,19 @@ struct _ActionsPlugin
   guint           invert_orientation : 1;
   guint           ask_confirmation : 1;
   guint           pack_idle_id;
+
+  /* cached result of the capability probes */
+  guint           allowed_types;
+
+  /* PATH the programs were looked up in */
+  gchar          *allowed_path;
+  GSList         *path_monitors;
+
+  /* session manager queries */
+  DBusGConnection *connection;
+  DBusGProxy      *session_proxy;
+  DBusGProxy      *bus_proxy;
+  GSList          *pending_calls;
 };
 
 typedef enum
@@ -383,6 +400,9 @@ actions_plugin_construct (XfcePanelPlugin *panel_plugin)
                          xfce_panel_plugin_get_property_base (panel_plugin),
                          properties, FALSE);
 
+  /* probe the capabilities before packing */
+  actions_plugin_capabilities_init (plugin);
+
   actions_plugin_pack (plugin);
 
   /* set orientation and size */
@@ -400,6 +420,8 @@ actions_plugin_free_data (XfcePanelPlugin *panel_plugin)
   if (plugin->pack_idle_id != 0)
     g_source_remove (plugin->pack_idle_id);
 
+  actions_plugin_capabilities_free (plugin);
+
   if (plugin->items != NULL)
     xfconf_array_free (plugin->items);
 
@@ -780,7 +802,7 @@ static DBusGProxy *
 actions_plugin_action_dbus_proxy_session (DBusGConnection *conn)
 {
   return dbus_g_proxy_new_for_name (conn,
-                                    "org.xfce.SessionManager",
+                                    SESSION_NAME,
                                     "/org/xfce/SessionManager",
                                     "org.xfce.Session.Manager");
 }
@@ -832,67 +854,306 @@ actions_plugin_action_dbus_xfsm (const gchar  *method,
 
 
 
-static gboolean
-actions_plugin_action_dbus_can (DBusGProxy  *proxy,
-                                const gchar *method)
+static void
+actions_plugin_capabilities_apply_widget (GtkWidget *widget,
+                                          gpointer   user_data)
 {
-  gboolean allowed = FALSE;
+  ActionsPlugin *plugin = XFCE_ACTIONS_PLUGIN (user_data);
+  ActionEntry   *entry;
 
-  if (dbus_g_proxy_call (proxy, method, NULL,
-                         G_TYPE_INVALID,
-                         G_TYPE_BOOLEAN, &allowed,
-                         G_TYPE_INVALID))
-    return allowed;
+  /* separators have no entry and are always sensitive */
+  entry = g_object_get_qdata (G_OBJECT (widget), action_quark);
+  if (entry != NULL)
+    gtk_widget_set_sensitive (widget, PANEL_HAS_FLAG (plugin->allowed_types, entry->type));
+}
 
-  return FALSE;
+
+
+static void
+actions_plugin_capabilities_apply (ActionsPlugin *plugin)
+{
+  GtkWidget *child;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  /* update the packed buttons and the menu in place */
+  child = gtk_bin_get_child (GTK_BIN (plugin));
+  if (child != NULL
+      && plugin->type == APPEARANCE_TYPE_BUTTONS)
+    gtk_container_foreach (GTK_CONTAINER (child),
+        actions_plugin_capabilities_apply_widget, plugin);
+
+  if (plugin->menu != NULL)
+    gtk_container_foreach (GTK_CONTAINER (plugin->menu),
+        actions_plugin_capabilities_apply_widget, plugin);
 }
 
 
 
-static ActionType
-actions_plugin_actions_allowed (void)
+static void
+actions_plugin_capabilities_programs (ActionsPlugin *plugin)
 {
-  DBusGConnection *conn;
-  ActionType       allow_mask = ACTION_TYPE_SEPARATOR;
-  gchar           *path;
-  DBusGProxy      *proxy;
-  GError          *error = NULL;
+  gchar *path;
 
   /* check for commands we use */
+  PANEL_UNSET_FLAG (plugin->allowed_types,
+                    ACTION_TYPE_SWITCH_USER | ACTION_TYPE_LOCK_SCREEN);
+
   path = g_find_program_in_path ("gdmflexiserver");
   if (path != NULL)
-    PANEL_SET_FLAG (allow_mask, ACTION_TYPE_SWITCH_USER);
+    PANEL_SET_FLAG (plugin->allowed_types, ACTION_TYPE_SWITCH_USER);
   g_free (path);
 
   path = g_find_program_in_path ("xflock4");
   if (path != NULL)
-    PANEL_SET_FLAG (allow_mask, ACTION_TYPE_LOCK_SCREEN);
+    PANEL_SET_FLAG (plugin->allowed_types, ACTION_TYPE_LOCK_SCREEN);
   g_free (path);
+}
+
+
+
+static void
+actions_plugin_capabilities_path_changed (GFileMonitor      *monitor,
+                                          GFile             *file,
+                                          GFile             *other_file,
+                                          GFileMonitorEvent  event_type,
+                                          ActionsPlugin     *plugin)
+{
+  gchar *basename;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  if (event_type != G_FILE_MONITOR_EVENT_CREATED
+      && event_type != G_FILE_MONITOR_EVENT_DELETED)
+    return;
+
+  /* only look the programs up again if one of them was (un)installed */
+  basename = g_file_get_basename (file);
+  if (g_strcmp0 (basename, "gdmflexiserver") == 0
+      || g_strcmp0 (basename, "xflock4") == 0)
+    {
+      actions_plugin_capabilities_programs (plugin);
+      actions_plugin_capabilities_apply (plugin);
+    }
+  g_free (basename);
+}
+
+
+
+static void
+actions_plugin_capabilities_path (ActionsPlugin *plugin)
+{
+  const gchar  *path;
+  gchar       **dirs;
+  guint         i;
+  GFile        *file;
+  GFileMonitor *monitor;
+  GSList       *li;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  /* nothing to do if the search path did not change */
+  path = g_getenv ("PATH");
+  if (plugin->path_monitors != NULL
+      && g_strcmp0 (path, plugin->allowed_path) == 0)
+    return;
+
+  g_free (plugin->allowed_path);
+  plugin->allowed_path = g_strdup (path);
+
+  for (li = plugin->path_monitors; li != NULL; li = li->next)
+    {
+      g_file_monitor_cancel (G_FILE_MONITOR (li->data));
+      g_object_unref (G_OBJECT (li->data));
+    }
+  g_slist_free (plugin->path_monitors);
+  plugin->path_monitors = NULL;
+
+  actions_plugin_capabilities_programs (plugin);
+
+  /* watch the path for the programs we use */
+  if (path != NULL)
+    {
+      dirs = g_strsplit (path, G_SEARCHPATH_SEPARATOR_S, -1);
+      for (i = 0; dirs[i] != NULL; i++)
+        {
+          if (*dirs[i] == '\0')
+            continue;
+
+          file = g_file_new_for_path (dirs[i]);
+          monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+          if (G_LIKELY (monitor != NULL))
+            {
+              g_signal_connect (G_OBJECT (monitor), "changed",
+                  G_CALLBACK (actions_plugin_capabilities_path_changed), plugin);
+              plugin->path_monitors = g_slist_prepend (plugin->path_monitors, monitor);
+            }
+          g_object_unref (G_OBJECT (file));
+        }
+      g_strfreev (dirs);
+    }
+}
+
+
+
+typedef struct
+{
+  ActionsPlugin *plugin;
+  ActionType     type;
+}
+ActionsCanCall;
+
+
+
+static void
+actions_plugin_capabilities_can_free (gpointer data)
+{
+  g_slice_free (ActionsCanCall, data);
+}
+
+
+
+static void
+actions_plugin_capabilities_can_reply (DBusGProxy     *proxy,
+                                       DBusGProxyCall *call,
+                                       gpointer        user_data)
+{
+  ActionsCanCall *can = user_data;
+  ActionsPlugin  *plugin = can->plugin;
+  gboolean        allowed = FALSE;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  plugin->pending_calls = g_slist_remove (plugin->pending_calls, call);
+
+  if (!dbus_g_proxy_end_call (proxy, call, NULL,
+                              G_TYPE_BOOLEAN, &allowed,
+                              G_TYPE_INVALID))
+    allowed = FALSE;
+
+  if (allowed)
+    PANEL_SET_FLAG (plugin->allowed_types, can->type);
+  else
+    PANEL_UNSET_FLAG (plugin->allowed_types, can->type);
+
+  actions_plugin_capabilities_apply (plugin);
+}
+
+
+
+static void
+actions_plugin_capabilities_session (ActionsPlugin *plugin)
+{
+  DBusGProxyCall *call;
+  ActionsCanCall *can;
+  GSList         *li;
+  guint           i;
+  const struct
+  {
+    const gchar *method;
+    ActionType   type;
+  }
+  methods[] =
+  {
+    { "CanShutdown", ACTION_TYPE_SHUTDOWN },
+    { "CanRestart", ACTION_TYPE_RESTART },
+    { "CanSuspend", ACTION_TYPE_SUSPEND },
+    { "CanHibernate", ACTION_TYPE_HIBERNATE }
+  };
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  /* drop the replies of an older probe */
+  for (li = plugin->pending_calls; li != NULL; li = li->next)
+    dbus_g_proxy_cancel_call (plugin->session_proxy, li->data);
+  g_slist_free (plugin->pending_calls);
+  plugin->pending_calls = NULL;
+
+  if (plugin->session_proxy == NULL)
+    return;
+
+  /* ask the session manager without blocking the panel, the
+   * actions stay insensitive until it replies */
+  for (i = 0; i < G_N_ELEMENTS (methods); i++)
+    {
+      can = g_slice_new (ActionsCanCall);
+      can->plugin = plugin;
+      can->type = methods[i].type;
+
+      call = dbus_g_proxy_begin_call (plugin->session_proxy, methods[i].method,
+                                      actions_plugin_capabilities_can_reply, can,
+                                      actions_plugin_capabilities_can_free,
+                                      G_TYPE_INVALID);
+      if (G_LIKELY (call != NULL))
+        plugin->pending_calls = g_slist_prepend (plugin->pending_calls, call);
+    }
+}
+
+
+
+static void
+actions_plugin_capabilities_owner_changed (DBusGProxy    *proxy,
+                                           const gchar   *name,
+                                           const gchar   *old_owner,
+                                           const gchar   *new_owner,
+                                           ActionsPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  if (g_strcmp0 (name, SESSION_NAME) != 0)
+    return;
+
+  /* the session manager (re)started or quit */
+  PANEL_UNSET_FLAG (plugin->allowed_types,
+                    ACTION_TYPE_SHUTDOWN | ACTION_TYPE_RESTART
+                    | ACTION_TYPE_SUSPEND | ACTION_TYPE_HIBERNATE);
+  actions_plugin_capabilities_apply (plugin);
+
+  if (!exo_str_is_empty (new_owner))
+    actions_plugin_capabilities_session (plugin);
+}
+
+
+
+static void
+actions_plugin_capabilities_init (ActionsPlugin *plugin)
+{
+  GError *error = NULL;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  plugin->allowed_types = ACTION_TYPE_SEPARATOR;
+
+  /* look up the programs and watch the path */
+  actions_plugin_capabilities_path (plugin);
 
   /* session bus for querying the managers */
-  conn = dbus_g_bus_get (DBUS_BUS_SESSION, &error);
-  if (conn != NULL)
+  plugin->connection = dbus_g_bus_get (DBUS_BUS_SESSION, &error);
+  if (plugin->connection != NULL)
     {
       /* xfce4-session */
-      proxy = actions_plugin_action_dbus_proxy_session (conn);
-      if (G_LIKELY (proxy != NULL))
+      plugin->session_proxy = actions_plugin_action_dbus_proxy_session (plugin->connection);
+      if (G_LIKELY (plugin->session_proxy != NULL))
         {
           /* when xfce4-session is connected, we can logout */
-          PANEL_SET_FLAG (allow_mask, ACTION_TYPE_LOGOUT | ACTION_TYPE_LOGOUT_DIALOG);
+          PANEL_SET_FLAG (plugin->allowed_types,
+                          ACTION_TYPE_LOGOUT | ACTION_TYPE_LOGOUT_DIALOG);
 
-          if (actions_plugin_action_dbus_can (proxy, "CanShutdown"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_SHUTDOWN);
-
-          if (actions_plugin_action_dbus_can (proxy, "CanRestart"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_RESTART);
-        
-          if (actions_plugin_action_dbus_can (proxy, "CanSuspend"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_SUSPEND);
-          
-          if (actions_plugin_action_dbus_can (proxy, "CanHibernate"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_HIBERNATE);
+          actions_plugin_capabilities_session (plugin);
+        }
 
-          g_object_unref (G_OBJECT (proxy));
+      /* probe again when the session manager restarts */
+      plugin->bus_proxy = dbus_g_proxy_new_for_name (plugin->connection,
+                                                     DBUS_SERVICE_DBUS,
+                                                     DBUS_PATH_DBUS,
+                                                     DBUS_INTERFACE_DBUS);
+      if (G_LIKELY (plugin->bus_proxy != NULL))
+        {
+          dbus_g_proxy_add_signal (plugin->bus_proxy, "NameOwnerChanged",
+                                   G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                   G_TYPE_INVALID);
+          dbus_g_proxy_connect_signal (plugin->bus_proxy, "NameOwnerChanged",
+              G_CALLBACK (actions_plugin_capabilities_owner_changed), plugin, NULL);
         }
     }
   else
@@ -900,8 +1161,43 @@ actions_plugin_actions_allowed (void)
       g_critical ("Unable to open DBus session bus: %s", error->message);
       g_error_free (error);
     }
+}
 
-  return allow_mask;
+
+
+static void
+actions_plugin_capabilities_free (ActionsPlugin *plugin)
+{
+  GSList *li;
+
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  for (li = plugin->pending_calls; li != NULL; li = li->next)
+    dbus_g_proxy_cancel_call (plugin->session_proxy, li->data);
+  g_slist_free (plugin->pending_calls);
+  plugin->pending_calls = NULL;
+
+  if (plugin->bus_proxy != NULL)
+    {
+      dbus_g_proxy_disconnect_signal (plugin->bus_proxy, "NameOwnerChanged",
+          G_CALLBACK (actions_plugin_capabilities_owner_changed), plugin);
+      g_object_unref (G_OBJECT (plugin->bus_proxy));
+    }
+
+  if (plugin->session_proxy != NULL)
+    g_object_unref (G_OBJECT (plugin->session_proxy));
+
+  if (plugin->connection != NULL)
+    dbus_g_connection_unref (plugin->connection);
+
+  for (li = plugin->path_monitors; li != NULL; li = li->next)
+    {
+      g_file_monitor_cancel (G_FILE_MONITOR (li->data));
+      g_object_unref (G_OBJECT (li->data));
+    }
+  g_slist_free (plugin->path_monitors);
+
+  g_free (plugin->allowed_path);
 }
 
 
@@ -1078,7 +1374,6 @@ actions_plugin_pack_idle (gpointer data)
   const GValue        *val;
   const gchar         *name;
   GtkOrientation       orientation;
-  ActionType           allowed_types;
   ActionType           type;
   XfcePanelPluginMode  mode;
 
@@ -1094,7 +1389,8 @@ actions_plugin_pack_idle (gpointer data)
 
   orientation = xfce_panel_plugin_get_orientation (XFCE_PANEL_PLUGIN (plugin));
 
-  allowed_types = actions_plugin_actions_allowed ();
+  /* the search path might have been changed */
+  actions_plugin_capabilities_path (plugin);
 
   if (plugin->type == APPEARANCE_TYPE_BUTTONS)
     {
@@ -1121,7 +1417,7 @@ actions_plugin_pack_idle (gpointer data)
           if (widget != NULL)
             {
               gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
-              gtk_widget_set_sensitive (widget, PANEL_HAS_FLAG (allowed_types, type));
+              gtk_widget_set_sensitive (widget, PANEL_HAS_FLAG (plugin->allowed_types, type));
               gtk_widget_show (widget);
             }
         }
@@ -1244,10 +1540,12 @@ actions_plugin_menu (GtkWidget     *button,
   GtkWidget    *mi;
   gint          w, h, size;
   ActionType    type;
-  ActionType    allowed_types;
 
   panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
 
+  /* the search path might have been changed */
+  actions_plugin_capabilities_path (plugin);
+
   if (plugin->menu == NULL)
     {
       plugin->menu = gtk_menu_new ();
@@ -1258,8 +1556,6 @@ actions_plugin_menu (GtkWidget     *button,
       if (gtk_icon_size_lookup (menu_icon_size, &w, &h))
         size = MIN (w, h);
 
-      allowed_types = actions_plugin_actions_allowed ();
-
       for (i = 0; i < plugin->items->len; i++)
         {
           val = g_ptr_array_index (plugin->items, i);
@@ -1271,7 +1567,7 @@ actions_plugin_menu (GtkWidget     *button,
           if (mi != NULL)
             {
               gtk_menu_shell_append (GTK_MENU_SHELL (plugin->menu), mi);
-              gtk_widget_set_sensitive (mi, PANEL_HAS_FLAG (allowed_types, type));
+              gtk_widget_set_sensitive (mi, PANEL_HAS_FLAG (plugin->allowed_types, type));
               gtk_widget_show (mi);
             }
         }
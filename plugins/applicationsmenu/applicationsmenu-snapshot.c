@@ -0,0 +1,869 @@
+/*
+ * Copyright (C) 2026 The Xfce development team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <libxfce4ui/libxfce4ui.h>
+#include <libxfce4util/libxfce4util.h>
+#include <libxfce4panel/libxfce4panel.h>
+#include <common/panel-private.h>
+#include <common/panel-debug.h>
+#include <common/panel-utils.h>
+
+#include "applicationsmenu-snapshot.h"
+
+
+
+/* the snapshot is a cache on the local machine, so everything is
+ * stored in host byte order; a foreign file fails the magic test */
+#define SNAPSHOT_MAGIC         (0x584d4e55)
+#define SNAPSHOT_VERSION       (2)
+#define SNAPSHOT_MTIME_MISSING (-1)
+
+/* how deep the menu and desktop file directories are scanned */
+#define SNAPSHOT_MAX_DEPTH     (8)
+
+
+
+typedef enum
+{
+  SNAPSHOT_NODE_MENU,
+  SNAPSHOT_NODE_ITEM,
+  SNAPSHOT_NODE_SEPARATOR
+}
+SnapshotNodeType;
+
+enum
+{
+  SNAPSHOT_ITEM_TERMINAL       = 1 << 0,
+  SNAPSHOT_ITEM_STARTUP_NOTIFY = 1 << 1
+};
+
+enum
+{
+  SNAPSHOT_SOURCE_DIRECTORY = 1 << 0
+};
+
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+
+  /* string with the menu file and locale */
+  guint32 key;
+
+  /* offsets of the tables in the file */
+  guint32 n_sources;
+  guint32 sources;
+  guint32 n_nodes;
+  guint32 nodes;
+  guint32 strings;
+}
+SnapshotHeader;
+
+typedef struct
+{
+  /* file or directory that contributed to the menu, the
+   * mtime is in nanoseconds if the platform supports it */
+  guint32 path;
+  guint32 flags;
+  gint64  mtime;
+}
+SnapshotSource;
+
+typedef struct
+{
+  guint32 type;
+
+  /* index of the first node after this (sub)tree */
+  guint32 end;
+
+  /* offsets in the string table, 0 is the empty string */
+  guint32 name;
+  guint32 generic_name;
+  guint32 comment;
+  guint32 icon_name;
+  guint32 command;
+  guint32 desktop_id;
+  guint32 categories;
+
+  /* desktop file uri (%k) and working directory of an item */
+  guint32 uri;
+  guint32 path;
+
+  guint32 flags;
+}
+SnapshotNode;
+
+struct _ApplicationsMenuSnapshot
+{
+  GMappedFile          *mapped;
+
+  const SnapshotSource *sources;
+  guint                 n_sources;
+  const SnapshotNode   *nodes;
+  guint                 n_nodes;
+  const gchar          *strings;
+  gsize                 strings_len;
+};
+
+typedef struct
+{
+  GString    *strings;
+  GHashTable *string_offsets;
+  GArray     *nodes;
+  GArray     *sources;
+  GHashTable *source_paths;
+}
+SnapshotWriter;
+
+typedef struct
+{
+  const gchar        *strings;
+  const SnapshotNode *node;
+}
+SnapshotItem;
+
+
+
+static gint64
+applications_menu_snapshot_mtime (const gchar *path)
+{
+  struct stat st;
+
+  /* whole seconds miss a file that is changed twice in a second */
+  if (g_stat (path, &st) == 0)
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    return (gint64) st.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+           + st.st_mtim.tv_nsec;
+#else
+    return (gint64) st.st_mtime * G_GINT64_CONSTANT (1000000000);
+#endif
+
+  return SNAPSHOT_MTIME_MISSING;
+}
+
+
+
+static guint32
+applications_menu_snapshot_writer_string (SnapshotWriter *writer,
+                                          const gchar    *str)
+{
+  guint32 offset;
+
+  if (str == NULL || *str == '\0')
+    return 0;
+
+  offset = GPOINTER_TO_UINT (g_hash_table_lookup (writer->string_offsets, str));
+  if (offset == 0)
+    {
+      offset = writer->strings->len;
+      g_string_append_len (writer->strings, str, strlen (str) + 1);
+      g_hash_table_insert (writer->string_offsets, g_strdup (str),
+                           GUINT_TO_POINTER (offset));
+    }
+
+  return offset;
+}
+
+
+
+static void
+applications_menu_snapshot_writer_source (SnapshotWriter *writer,
+                                          const gchar    *path,
+                                          guint32         flags)
+{
+  SnapshotSource source;
+
+  if (path == NULL
+      || g_hash_table_lookup (writer->source_paths, path) != NULL)
+    return;
+
+  g_hash_table_insert (writer->source_paths, g_strdup (path),
+                       GINT_TO_POINTER (TRUE));
+
+  source.path = applications_menu_snapshot_writer_string (writer, path);
+  source.flags = flags;
+  source.mtime = applications_menu_snapshot_mtime (path);
+  g_array_append_val (writer->sources, source);
+}
+
+
+
+static void
+applications_menu_snapshot_writer_file (SnapshotWriter *writer,
+                                        GFile          *file)
+{
+  gchar *path;
+  gchar *dirname;
+
+  if (G_UNLIKELY (file == NULL))
+    return;
+
+  path = g_file_get_path (file);
+  if (G_LIKELY (path != NULL))
+    {
+      /* the file for edits, its directory for added and removed files */
+      applications_menu_snapshot_writer_source (writer, path, 0);
+
+      dirname = g_path_get_dirname (path);
+      applications_menu_snapshot_writer_source (writer, dirname,
+                                                SNAPSHOT_SOURCE_DIRECTORY);
+      g_free (dirname);
+      g_free (path);
+    }
+}
+
+
+
+static void
+applications_menu_snapshot_writer_menu (SnapshotWriter *writer,
+                                        GarconMenu     *menu)
+{
+  SnapshotNode         node;
+  guint                index;
+  GList               *elements, *li;
+  GList               *categories, *lp;
+  GString             *str;
+  gchar               *uri;
+
+  memset (&node, 0, sizeof (node));
+  node.type = SNAPSHOT_NODE_MENU;
+  node.name = applications_menu_snapshot_writer_string (writer,
+      garcon_menu_element_get_name (GARCON_MENU_ELEMENT (menu)));
+  node.comment = applications_menu_snapshot_writer_string (writer,
+      garcon_menu_element_get_comment (GARCON_MENU_ELEMENT (menu)));
+  node.icon_name = applications_menu_snapshot_writer_string (writer,
+      garcon_menu_element_get_icon_name (GARCON_MENU_ELEMENT (menu)));
+
+  index = writer->nodes->len;
+  g_array_append_val (writer->nodes, node);
+
+  elements = garcon_menu_get_elements (menu);
+  for (li = elements; li != NULL; li = li->next)
+    {
+      if (GARCON_IS_MENU_SEPARATOR (li->data))
+        {
+          memset (&node, 0, sizeof (node));
+          node.type = SNAPSHOT_NODE_SEPARATOR;
+          g_array_append_val (writer->nodes, node);
+          continue;
+        }
+
+      /* hidden elements are never shown, skip them */
+      if (!garcon_menu_element_get_visible (li->data))
+        continue;
+
+      if (GARCON_IS_MENU (li->data))
+        {
+          applications_menu_snapshot_writer_menu (writer, li->data);
+        }
+      else if (GARCON_IS_MENU_ITEM (li->data))
+        {
+          memset (&node, 0, sizeof (node));
+          node.type = SNAPSHOT_NODE_ITEM;
+          node.name = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_element_get_name (li->data));
+          node.generic_name = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_item_get_generic_name (li->data));
+          node.comment = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_element_get_comment (li->data));
+          node.icon_name = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_element_get_icon_name (li->data));
+          node.command = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_item_get_command (li->data));
+          node.desktop_id = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_item_get_desktop_id (li->data));
+          node.path = applications_menu_snapshot_writer_string (writer,
+              garcon_menu_item_get_path (li->data));
+
+          uri = garcon_menu_item_get_uri (li->data);
+          node.uri = applications_menu_snapshot_writer_string (writer, uri);
+          g_free (uri);
+
+          categories = garcon_menu_item_get_categories (li->data);
+          if (categories != NULL)
+            {
+              str = g_string_new (NULL);
+              for (lp = categories; lp != NULL; lp = lp->next)
+                g_string_append_printf (str, "%s;", (const gchar *) lp->data);
+              node.categories = applications_menu_snapshot_writer_string (writer, str->str);
+              g_string_free (str, TRUE);
+            }
+
+          if (garcon_menu_item_requires_terminal (li->data))
+            node.flags |= SNAPSHOT_ITEM_TERMINAL;
+          if (garcon_menu_item_supports_startup_notification (li->data))
+            node.flags |= SNAPSHOT_ITEM_STARTUP_NOTIFY;
+
+          g_array_append_val (writer->nodes, node);
+        }
+    }
+  g_list_free (elements);
+
+  g_array_index (writer->nodes, SnapshotNode, index).end = writer->nodes->len;
+}
+
+
+
+static void
+applications_menu_snapshot_writer_sources (SnapshotWriter *writer,
+                                           GarconMenu     *menu)
+{
+  GarconMenuDirectory *directory;
+  GList               *elements, *li;
+  GFile               *file;
+
+  directory = garcon_menu_get_directory (menu);
+  if (directory != NULL)
+    {
+      file = garcon_menu_directory_get_file (directory);
+      applications_menu_snapshot_writer_file (writer, file);
+      g_object_unref (G_OBJECT (file));
+    }
+
+  /* also hidden elements, showing them changes the menu */
+  elements = garcon_menu_get_elements (menu);
+  for (li = elements; li != NULL; li = li->next)
+    {
+      if (GARCON_IS_MENU (li->data))
+        {
+          applications_menu_snapshot_writer_sources (writer, li->data);
+        }
+      else if (GARCON_IS_MENU_ITEM (li->data))
+        {
+          file = garcon_menu_item_get_file (li->data);
+          applications_menu_snapshot_writer_file (writer, file);
+          g_object_unref (G_OBJECT (file));
+        }
+    }
+  g_list_free (elements);
+}
+
+
+
+static void
+applications_menu_snapshot_writer_directory (SnapshotWriter *writer,
+                                             const gchar    *path,
+                                             guint           depth)
+{
+  GDir        *dir;
+  const gchar *name;
+  gchar       *filename;
+
+  /* also record directories that don't exist (yet), a menu or
+   * desktop file that shows up there changes the resolved menu */
+  applications_menu_snapshot_writer_source (writer, path,
+                                            SNAPSHOT_SOURCE_DIRECTORY);
+
+  if (depth >= SNAPSHOT_MAX_DEPTH)
+    return;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  /* record all menu files (including the merged ones) and desktop
+   * files, not only those that ended up in the resolved tree */
+  for (;;)
+    {
+      name = g_dir_read_name (dir);
+      if (name == NULL)
+        break;
+
+      filename = g_build_filename (path, name, NULL);
+      if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+        applications_menu_snapshot_writer_directory (writer, filename, depth + 1);
+      else if (g_str_has_suffix (name, ".menu")
+               || g_str_has_suffix (name, ".desktop")
+               || g_str_has_suffix (name, ".directory"))
+        applications_menu_snapshot_writer_source (writer, filename, 0);
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+}
+
+
+
+static void
+applications_menu_snapshot_roots_append (GPtrArray        *roots,
+                                         XfceResourceType  type,
+                                         const gchar      *name)
+{
+  gchar **dirs;
+  guint   i;
+
+  dirs = xfce_resource_dirs (type);
+  for (i = 0; dirs != NULL && dirs[i] != NULL; i++)
+    g_ptr_array_add (roots, g_build_filename (dirs[i], name, NULL));
+  g_strfreev (dirs);
+}
+
+
+
+gchar **
+applications_menu_snapshot_get_roots (void)
+{
+  GPtrArray *roots;
+
+  /* xfce_resource_dirs is not thread-safe, so the directories
+   * are looked up here and scanned by the (threaded) writer */
+  roots = g_ptr_array_new ();
+  applications_menu_snapshot_roots_append (roots, XFCE_RESOURCE_CONFIG, "menus");
+  applications_menu_snapshot_roots_append (roots, XFCE_RESOURCE_DATA, "applications");
+  applications_menu_snapshot_roots_append (roots, XFCE_RESOURCE_DATA, "desktop-directories");
+  g_ptr_array_add (roots, NULL);
+
+  return (gchar **) g_ptr_array_free (roots, FALSE);
+}
+
+
+
+gboolean
+applications_menu_snapshot_save (GarconMenu   *menu,
+                                 gchar       **roots,
+                                 const gchar  *filename,
+                                 const gchar  *key,
+                                 GError      **error)
+{
+  SnapshotWriter  writer;
+  SnapshotHeader  header;
+  GString        *contents;
+  GFile          *file;
+  gboolean        succeed;
+  guint           i;
+
+  panel_return_val_if_fail (GARCON_IS_MENU (menu), FALSE);
+  panel_return_val_if_fail (filename != NULL, FALSE);
+  panel_return_val_if_fail (key != NULL, FALSE);
+
+  writer.strings = g_string_sized_new (16384);
+  writer.string_offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  writer.nodes = g_array_new (FALSE, FALSE, sizeof (SnapshotNode));
+  writer.sources = g_array_new (FALSE, FALSE, sizeof (SnapshotSource));
+  writer.source_paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* offset 0 is the empty string */
+  g_string_append_c (writer.strings, '\0');
+
+  memset (&header, 0, sizeof (header));
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.key = applications_menu_snapshot_writer_string (&writer, key);
+
+  file = garcon_menu_get_file (menu);
+  applications_menu_snapshot_writer_file (&writer, file);
+  g_object_unref (G_OBJECT (file));
+
+  applications_menu_snapshot_writer_sources (&writer, menu);
+  for (i = 0; roots != NULL && roots[i] != NULL; i++)
+    applications_menu_snapshot_writer_directory (&writer, roots[i], 0);
+
+  applications_menu_snapshot_writer_menu (&writer, menu);
+
+  header.n_sources = writer.sources->len;
+  header.sources = sizeof (SnapshotHeader);
+  header.n_nodes = writer.nodes->len;
+  header.nodes = header.sources + header.n_sources * sizeof (SnapshotSource);
+  header.strings = header.nodes + header.n_nodes * sizeof (SnapshotNode);
+
+  contents = g_string_sized_new (header.strings + writer.strings->len);
+  g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+  g_string_append_len (contents, writer.sources->data,
+                       writer.sources->len * sizeof (SnapshotSource));
+  g_string_append_len (contents, writer.nodes->data,
+                       writer.nodes->len * sizeof (SnapshotNode));
+  g_string_append_len (contents, writer.strings->str, writer.strings->len);
+
+  succeed = g_file_set_contents (filename, contents->str, contents->len, error);
+
+  g_string_free (contents, TRUE);
+  g_string_free (writer.strings, TRUE);
+  g_hash_table_destroy (writer.string_offsets);
+  g_array_free (writer.nodes, TRUE);
+  g_array_free (writer.sources, TRUE);
+  g_hash_table_destroy (writer.source_paths);
+
+  return succeed;
+}
+
+
+
+static gboolean
+applications_menu_snapshot_validate (ApplicationsMenuSnapshot *snapshot)
+{
+  const SnapshotNode *node;
+  guint               i;
+
+  for (i = 0; i < snapshot->n_sources; i++)
+    if (snapshot->sources[i].path >= snapshot->strings_len)
+      return FALSE;
+
+  /* the first node is the root menu that spans the whole tree */
+  if (snapshot->n_nodes == 0
+      || snapshot->nodes[0].type != SNAPSHOT_NODE_MENU
+      || snapshot->nodes[0].end != snapshot->n_nodes)
+    return FALSE;
+
+  for (i = 0; i < snapshot->n_nodes; i++)
+    {
+      node = &snapshot->nodes[i];
+
+      if (node->type > SNAPSHOT_NODE_SEPARATOR
+          || node->name >= snapshot->strings_len
+          || node->generic_name >= snapshot->strings_len
+          || node->comment >= snapshot->strings_len
+          || node->icon_name >= snapshot->strings_len
+          || node->command >= snapshot->strings_len
+          || node->desktop_id >= snapshot->strings_len
+          || node->categories >= snapshot->strings_len
+          || node->uri >= snapshot->strings_len
+          || node->path >= snapshot->strings_len)
+        return FALSE;
+
+      if (node->type == SNAPSHOT_NODE_MENU
+          && (node->end <= i || node->end > snapshot->nodes[0].end))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+ApplicationsMenuSnapshot *
+applications_menu_snapshot_load (const gchar *filename,
+                                 const gchar *key)
+{
+  ApplicationsMenuSnapshot *snapshot;
+  GMappedFile              *mapped;
+  const gchar              *contents;
+  gsize                     length;
+  const SnapshotHeader     *header;
+  const SnapshotSource     *source;
+  guint                     i;
+
+  panel_return_val_if_fail (filename != NULL, NULL);
+  panel_return_val_if_fail (key != NULL, NULL);
+
+  mapped = g_mapped_file_new (filename, FALSE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  contents = g_mapped_file_get_contents (mapped);
+  length = g_mapped_file_get_length (mapped);
+  header = (const SnapshotHeader *) contents;
+
+  /* check the tables are inside the file and the last string is
+   * terminated, so we never read outside the mapping */
+  if (length < sizeof (SnapshotHeader)
+      || header->magic != SNAPSHOT_MAGIC
+      || header->version != SNAPSHOT_VERSION
+      || header->sources % sizeof (gint64) != 0
+      || header->nodes % sizeof (guint32) != 0
+      || (guint64) header->sources + (guint64) header->n_sources * sizeof (SnapshotSource) > length
+      || (guint64) header->nodes + (guint64) header->n_nodes * sizeof (SnapshotNode) > length
+      || header->strings >= length
+      || contents[length - 1] != '\0')
+    {
+      panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+                   "snapshot \"%s\" is invalid", filename);
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  snapshot = g_slice_new0 (ApplicationsMenuSnapshot);
+  snapshot->mapped = mapped;
+  snapshot->sources = (const SnapshotSource *) (contents + header->sources);
+  snapshot->n_sources = header->n_sources;
+  snapshot->nodes = (const SnapshotNode *) (contents + header->nodes);
+  snapshot->n_nodes = header->n_nodes;
+  snapshot->strings = contents + header->strings;
+  snapshot->strings_len = length - header->strings;
+
+  if (header->key >= snapshot->strings_len
+      || !applications_menu_snapshot_validate (snapshot))
+    {
+      panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+                   "snapshot \"%s\" is invalid", filename);
+      applications_menu_snapshot_free (snapshot);
+      return NULL;
+    }
+
+  /* different menu file, menu prefix or locale */
+  if (strcmp (snapshot->strings + header->key, key) != 0)
+    {
+      panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+                   "snapshot \"%s\" is for another menu", filename);
+      applications_menu_snapshot_free (snapshot);
+      return NULL;
+    }
+
+  /* check nothing changed on disk since the snapshot was taken */
+  for (i = 0; i < snapshot->n_sources; i++)
+    {
+      source = &snapshot->sources[i];
+      if (applications_menu_snapshot_mtime (snapshot->strings + source->path)
+          != source->mtime)
+        {
+          panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+                       "snapshot \"%s\" is outdated by \"%s\"", filename,
+                       snapshot->strings + source->path);
+          applications_menu_snapshot_free (snapshot);
+          return NULL;
+        }
+    }
+
+  panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+               "loaded snapshot \"%s\" with %d nodes",
+               filename, snapshot->n_nodes);
+
+  return snapshot;
+}
+
+
+
+void
+applications_menu_snapshot_free (ApplicationsMenuSnapshot *snapshot)
+{
+  g_mapped_file_unref (snapshot->mapped);
+  g_slice_free (ApplicationsMenuSnapshot, snapshot);
+}
+
+
+
+gchar **
+applications_menu_snapshot_get_directories (ApplicationsMenuSnapshot *snapshot)
+{
+  GPtrArray *directories;
+  guint      i;
+
+  panel_return_val_if_fail (snapshot != NULL, NULL);
+
+  /* the directories to monitor, a change in the files they
+   * contain is also reported by a directory monitor */
+  directories = g_ptr_array_new ();
+  for (i = 0; i < snapshot->n_sources; i++)
+    if (PANEL_HAS_FLAG (snapshot->sources[i].flags, SNAPSHOT_SOURCE_DIRECTORY))
+      g_ptr_array_add (directories,
+                       g_strdup (snapshot->strings + snapshot->sources[i].path));
+  g_ptr_array_add (directories, NULL);
+
+  return (gchar **) g_ptr_array_free (directories, FALSE);
+}
+
+
+
+static void
+applications_menu_snapshot_item_activate (GtkWidget    *mi,
+                                          SnapshotItem *item)
+{
+  const SnapshotNode  *node = item->node;
+  gchar              **argv;
+  gboolean             succeed = FALSE;
+  GError              *error = NULL;
+
+  panel_return_if_fail (node->command != 0);
+
+  /* same expansion as the launcher, there are no files or
+   * urls to pass from a menu */
+  if (panel_utils_exec_parse (item->strings + node->command,
+                              PANEL_HAS_FLAG (node->flags, SNAPSHOT_ITEM_TERMINAL),
+                              item->strings + node->icon_name,
+                              item->strings + node->name,
+                              item->strings + node->uri,
+                              NULL, &argv, &error))
+    {
+      /* launch the command on the screen */
+      succeed = xfce_spawn_on_screen (gtk_widget_get_screen (mi),
+                                      node->path != 0 ? item->strings + node->path : NULL,
+                                      argv, NULL, G_SPAWN_SEARCH_PATH,
+                                      PANEL_HAS_FLAG (node->flags, SNAPSHOT_ITEM_STARTUP_NOTIFY),
+                                      gtk_get_current_event_time (),
+                                      node->icon_name != 0 ? item->strings + node->icon_name : NULL,
+                                      &error);
+
+      g_strfreev (argv);
+    }
+
+  if (G_UNLIKELY (!succeed))
+    {
+      xfce_dialog_show_error (NULL, error, _("Failed to execute command \"%s\"."),
+                              item->strings + node->command);
+      g_error_free (error);
+    }
+}
+
+
+
+static void
+applications_menu_snapshot_item_free (gpointer  data,
+                                      GClosure *closure)
+{
+  g_slice_free (SnapshotItem, data);
+}
+
+
+
+static GtkWidget *
+applications_menu_snapshot_menu_item_new (const gchar *label,
+                                          const gchar *icon_name,
+                                          const gchar *comment,
+                                          gboolean     show_menu_icons,
+                                          gboolean     show_tooltips)
+{
+  GtkWidget *mi;
+  GtkWidget *image;
+  gint       w, h;
+
+  mi = gtk_image_menu_item_new_with_label (label);
+
+  if (show_tooltips && *comment != '\0')
+    gtk_widget_set_tooltip_text (mi, comment);
+
+  if (show_menu_icons && *icon_name != '\0')
+    {
+      if (!gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &w, &h))
+        w = h = 16;
+
+      image = xfce_panel_image_new_from_source (icon_name);
+      xfce_panel_image_set_size (XFCE_PANEL_IMAGE (image), MIN (w, h));
+      gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+      gtk_widget_show (image);
+    }
+
+  return mi;
+}
+
+
+
+static guint
+applications_menu_snapshot_menu_add (ApplicationsMenuSnapshot *snapshot,
+                                     GtkWidget                *menu,
+                                     guint                     first,
+                                     guint                     end,
+                                     gboolean                  show_generic_names,
+                                     gboolean                  show_menu_icons,
+                                     gboolean                  show_tooltips)
+{
+  const SnapshotNode *node;
+  const gchar        *label;
+  GtkWidget          *mi, *submenu;
+  SnapshotItem       *item;
+  guint               i, n_items = 0;
+
+  for (i = first; i < end; i++)
+    {
+      node = &snapshot->nodes[i];
+
+      if (node->type == SNAPSHOT_NODE_SEPARATOR)
+        {
+          mi = gtk_separator_menu_item_new ();
+          gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
+          gtk_widget_show (mi);
+        }
+      else if (node->type == SNAPSHOT_NODE_MENU)
+        {
+          /* skip submenus without items */
+          submenu = gtk_menu_new ();
+          if (applications_menu_snapshot_menu_add (snapshot, submenu, i + 1, node->end,
+                                                   show_generic_names, show_menu_icons,
+                                                   show_tooltips) == 0)
+            {
+              gtk_widget_destroy (submenu);
+            }
+          else
+            {
+              mi = applications_menu_snapshot_menu_item_new (
+                  snapshot->strings + node->name,
+                  snapshot->strings + node->icon_name,
+                  snapshot->strings + node->comment,
+                  show_menu_icons, show_tooltips);
+              gtk_menu_item_set_submenu (GTK_MENU_ITEM (mi), submenu);
+              gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
+              gtk_widget_show (mi);
+              n_items++;
+            }
+
+          /* continue after the submenu */
+          i = node->end - 1;
+        }
+      else
+        {
+          label = snapshot->strings + node->name;
+          if (show_generic_names && node->generic_name != 0)
+            label = snapshot->strings + node->generic_name;
+
+          mi = applications_menu_snapshot_menu_item_new (label,
+              snapshot->strings + node->icon_name,
+              snapshot->strings + node->comment,
+              show_menu_icons, show_tooltips);
+          gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
+          gtk_widget_show (mi);
+          n_items++;
+
+          item = g_slice_new (SnapshotItem);
+          item->strings = snapshot->strings;
+          item->node = node;
+          g_signal_connect_data (G_OBJECT (mi), "activate",
+              G_CALLBACK (applications_menu_snapshot_item_activate), item,
+              applications_menu_snapshot_item_free, 0);
+        }
+    }
+
+  return n_items;
+}
+
+
+
+GtkWidget *
+applications_menu_snapshot_create_menu (ApplicationsMenuSnapshot *snapshot,
+                                        gboolean                  show_generic_names,
+                                        gboolean                  show_menu_icons,
+                                        gboolean                  show_tooltips)
+{
+  GtkWidget *menu;
+
+  panel_return_val_if_fail (snapshot != NULL, NULL);
+
+  menu = gtk_menu_new ();
+
+  /* the items point into the mapped file */
+  g_object_set_data_full (G_OBJECT (menu), "snapshot-mapped-file",
+                          g_mapped_file_ref (snapshot->mapped),
+                          (GDestroyNotify) g_mapped_file_unref);
+
+  applications_menu_snapshot_menu_add (snapshot, menu, 1, snapshot->nodes[0].end,
+                                       show_generic_names, show_menu_icons,
+                                       show_tooltips);
+
+  return menu;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 The Xfce development team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __XFCE_APPLICATIONS_MENU_SNAPSHOT_H__
+#define __XFCE_APPLICATIONS_MENU_SNAPSHOT_H__
+
+#include <gtk/gtk.h>
+#include <garcon/garcon.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ApplicationsMenuSnapshot ApplicationsMenuSnapshot;
+
+ApplicationsMenuSnapshot *applications_menu_snapshot_load            (const gchar               *filename,
+                                                                      const gchar               *key);
+
+void                      applications_menu_snapshot_free            (ApplicationsMenuSnapshot  *snapshot);
+
+gboolean                  applications_menu_snapshot_save            (GarconMenu                *menu,
+                                                                      gchar                    **roots,
+                                                                      const gchar               *filename,
+                                                                      const gchar               *key,
+                                                                      GError                   **error);
+
+gchar                   **applications_menu_snapshot_get_roots      (void);
+
+gchar                   **applications_menu_snapshot_get_directories (ApplicationsMenuSnapshot  *snapshot);
+
+GtkWidget                *applications_menu_snapshot_create_menu     (ApplicationsMenuSnapshot  *snapshot,
+                                                                      gboolean                   show_generic_names,
+                                                                      gboolean                   show_menu_icons,
+                                                                      gboolean                   show_tooltips);
+
+G_END_DECLS
+
+#endif /* !__XFCE_APPLICATIONS_MENU_SNAPSHOT_H__ */
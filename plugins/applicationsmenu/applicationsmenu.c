@@ -32,6 +32,7 @@
 #include <common/panel-debug.h>
 
 #include "applicationsmenu.h"
+#include "applicationsmenu-snapshot.h"
 #include "applicationsmenu-dialog_ui.h"
 
 
@@ -39,6 +40,8 @@
 #define DEFAULT_TITLE     _("Applications Menu")
 #define DEFAULT_ICON_NAME "xfce4-panel-menu"
 #define DEFAULT_ICON_SIZE (16)
+#define SNAPSHOT_FILE     "xfce4" G_DIR_SEPARATOR_S "panel" G_DIR_SEPARATOR_S "applicationsmenu-%d.snapshot"
+#define DIGEST_STR(str)   ((str) != NULL ? (str) : "")
 
 
 
@@ -59,6 +62,22 @@ struct _ApplicationsMenuPlugin
 
   guint            is_constructed : 1;
 
+  /* menu tree handed to the garcon-gtk menu */
+  GarconMenu      *garcon_menu;
+  gchar           *garcon_menu_digest;
+
+  /* background parsing and idle item creation */
+  GCancellable    *load_cancellable;
+  guint            build_idle_id;
+
+  /* shown when the menu is opened before the tree is parsed */
+  GtkWidget       *loading_menu;
+
+  /* menu from the snapshot until the tree is parsed */
+  ApplicationsMenuSnapshot *snapshot;
+  GtkWidget       *snapshot_menu;
+  GSList          *snapshot_monitors;
+
   guint            show_button_title : 1;
   gchar           *button_title;
   gchar           *button_icon;
@@ -83,6 +102,30 @@ enum
   PROP_CUSTOM_MENU_FILE
 };
 
+typedef struct
+{
+  ApplicationsMenuPlugin *plugin;
+  GarconMenu             *menu;
+  GCancellable           *cancellable;
+  GError                 *error;
+
+  /* where the parsed tree is written */
+  gchar                  *snapshot_file;
+  gchar                  *snapshot_key;
+  gchar                 **snapshot_roots;
+}
+ApplicationsMenuLoad;
+
+typedef struct
+{
+  ApplicationsMenuPlugin   *plugin;
+  GCancellable             *cancellable;
+  gchar                    *filename;
+  gchar                    *key;
+  ApplicationsMenuSnapshot *snapshot;
+}
+ApplicationsMenuRestore;
+
 
 
 static void      applications_menu_plugin_get_property         (GObject                *object,
@@ -109,6 +152,15 @@ static gboolean  applications_menu_plugin_menu                 (GtkWidget
 static void      applications_menu_plugin_menu_deactivate      (GtkWidget              *menu,
                                                                 GtkWidget              *button);
 static void      applications_menu_plugin_set_garcon_menu      (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_menu_load            (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_menu_load_cancel     (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_menu_unset           (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_menu_set             (ApplicationsMenuPlugin *plugin,
+                                                                GarconMenu             *menu,
+                                                                gchar                  *digest);
+static GarconMenu *applications_menu_plugin_menu_new           (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_loading_unset        (ApplicationsMenuPlugin *plugin);
+static void      applications_menu_plugin_snapshot_unset       (ApplicationsMenuPlugin *plugin);
 
 
 
@@ -292,22 +344,26 @@ applications_menu_plugin_set_property (GObject      *object,
 {
   ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (object);
   gboolean                force_a_resize = FALSE;
+  gboolean                reset_snapshot_menu = FALSE;
 
   switch (prop_id)
     {
     case PROP_SHOW_GENERIC_NAMES:
       garcon_gtk_menu_set_show_generic_names (GARCON_GTK_MENU (plugin->menu),
                                               g_value_get_boolean (value));
+      reset_snapshot_menu = TRUE;
       break;
 
     case PROP_SHOW_MENU_ICONS:
       garcon_gtk_menu_set_show_menu_icons (GARCON_GTK_MENU (plugin->menu),
                                            g_value_get_boolean (value));
-       break;
+      reset_snapshot_menu = TRUE;
+      break;
 
     case PROP_SHOW_TOOLTIPS:
       garcon_gtk_menu_set_show_tooltips (GARCON_GTK_MENU (plugin->menu),
                                          g_value_get_boolean (value));
+      reset_snapshot_menu = TRUE;
       break;
 
     case PROP_SHOW_BUTTON_TITLE:
@@ -368,6 +424,14 @@ applications_menu_plugin_set_property (GObject      *object,
       applications_menu_plugin_size_changed (XFCE_PANEL_PLUGIN (plugin),
           xfce_panel_plugin_get_size (XFCE_PANEL_PLUGIN (plugin)));
     }
+
+  /* rebuilt from the snapshot on the next popup */
+  if (reset_snapshot_menu
+      && plugin->snapshot_menu != NULL)
+    {
+      gtk_widget_destroy (plugin->snapshot_menu);
+      plugin->snapshot_menu = NULL;
+    }
 }
 
 
@@ -411,6 +475,16 @@ applications_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
 {
   ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (panel_plugin);
 
+  /* stop a running load and the idle build */
+  applications_menu_plugin_menu_load_cancel (plugin);
+
+  if (plugin->build_idle_id != 0)
+    g_source_remove (plugin->build_idle_id);
+
+  applications_menu_plugin_menu_unset (plugin);
+  applications_menu_plugin_loading_unset (plugin);
+  applications_menu_plugin_snapshot_unset (plugin);
+
   if (plugin->menu != NULL)
     gtk_widget_destroy (plugin->menu);
 
@@ -722,14 +796,543 @@ applications_menu_plugin_menu_deactivate (GtkWidget *menu,
 
 
 static void
-applications_menu_plugin_set_garcon_menu (ApplicationsMenuPlugin *plugin)
+applications_menu_plugin_menu_digest (GarconMenu *menu,
+                                      GString    *digest)
 {
-  GarconMenu *menu = NULL;
-  gchar      *filename;
-  GFile      *file;
+  GList       *elements, *li;
+
+  panel_return_if_fail (GARCON_IS_MENU (menu));
+
+  /* everything the garcon-gtk menu shows of an element, so an equal
+   * digest means the reloaded tree looks the same as the current one */
+  g_string_append_printf (digest, "[%s|%s\n",
+                          DIGEST_STR (garcon_menu_element_get_name (GARCON_MENU_ELEMENT (menu))),
+                          DIGEST_STR (garcon_menu_element_get_icon_name (GARCON_MENU_ELEMENT (menu))));
+
+  elements = garcon_menu_get_elements (menu);
+  for (li = elements; li != NULL; li = li->next)
+    {
+      if (GARCON_IS_MENU (li->data))
+        {
+          applications_menu_plugin_menu_digest (li->data, digest);
+        }
+      else if (GARCON_IS_MENU_SEPARATOR (li->data))
+        {
+          g_string_append (digest, "-\n");
+        }
+      else if (GARCON_IS_MENU_ITEM (li->data))
+        {
+          g_string_append_printf (digest, "%s|%s|%s|%s|%s|%s|%d\n",
+              DIGEST_STR (garcon_menu_item_get_desktop_id (li->data)),
+              DIGEST_STR (garcon_menu_element_get_name (li->data)),
+              DIGEST_STR (garcon_menu_item_get_generic_name (li->data)),
+              DIGEST_STR (garcon_menu_element_get_comment (li->data)),
+              DIGEST_STR (garcon_menu_element_get_icon_name (li->data)),
+              DIGEST_STR (garcon_menu_item_get_command (li->data)),
+              garcon_menu_element_get_visible (li->data));
+        }
+    }
+  g_list_free (elements);
+
+  g_string_append (digest, "]\n");
+}
+
+
+
+static gboolean
+applications_menu_plugin_menu_build_idle (gpointer user_data)
+{
+  ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (user_data);
+  GtkWidget              *toplevel;
 
+  panel_return_val_if_fail (GARCON_GTK_IS_MENU (plugin->menu), FALSE);
+
+  GDK_THREADS_ENTER ();
+
+  /* leave a menu that is popped up alone */
+  toplevel = gtk_widget_get_toplevel (plugin->menu);
+  if (toplevel == NULL || !GTK_WIDGET_VISIBLE (toplevel))
+    {
+      /* showing the unmapped menu makes garcon-gtk create all the
+       * items now, instead of when the user clicks the button */
+      gtk_widget_hide (plugin->menu);
+      gtk_widget_show (plugin->menu);
+    }
+
+  /* we reload the tree in the background, don't let garcon-gtk
+   * throw away its items and parse the files again on popup */
+  if (plugin->garcon_menu != NULL)
+    g_signal_handlers_block_matched (G_OBJECT (plugin->garcon_menu),
+                                     G_SIGNAL_MATCH_DATA, 0, 0,
+                                     NULL, NULL, plugin->menu);
+
+  GDK_THREADS_LEAVE ();
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_menu_build_idle_destroyed (gpointer user_data)
+{
+  XFCE_APPLICATIONS_MENU_PLUGIN (user_data)->build_idle_id = 0;
+}
+
+
+
+static void
+applications_menu_plugin_menu_reload_required (GarconMenu             *menu,
+                                               ApplicationsMenuPlugin *plugin)
+{
   panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
-  panel_return_if_fail (GARCON_GTK_IS_MENU (plugin->menu));
+  panel_return_if_fail (plugin->garcon_menu == menu);
+
+  panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "menu files changed, reloading");
+
+  /* parse the new tree, it is only used if it differs */
+  applications_menu_plugin_menu_load (plugin);
+}
+
+
+
+static void
+applications_menu_plugin_menu_unset (ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  if (plugin->garcon_menu != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->garcon_menu),
+          G_CALLBACK (applications_menu_plugin_menu_reload_required), plugin);
+      g_object_unref (G_OBJECT (plugin->garcon_menu));
+      plugin->garcon_menu = NULL;
+    }
+
+  g_free (plugin->garcon_menu_digest);
+  plugin->garcon_menu_digest = NULL;
+}
+
+
+
+static gboolean
+applications_menu_plugin_menu_load_finished (gpointer user_data)
+{
+  ApplicationsMenuLoad   *load = user_data;
+  ApplicationsMenuPlugin *plugin = load->plugin;
+  GString                *digest;
+  gchar                  *checksum;
+  gchar                  *filename;
+  GFile                  *file;
+
+  /* the plugin is gone or a newer load replaced this one */
+  if (g_cancellable_is_cancelled (load->cancellable))
+    return FALSE;
+
+  panel_return_val_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin), FALSE);
+  panel_return_val_if_fail (plugin->load_cancellable == load->cancellable, FALSE);
+
+  g_object_unref (G_OBJECT (plugin->load_cancellable));
+  plugin->load_cancellable = NULL;
+
+  if (G_UNLIKELY (load->error != NULL))
+    {
+      /* hand the menu over anyway, garcon-gtk shows the error */
+      g_warning ("Failed to load the applications menu: %s",
+                 load->error->message);
+      checksum = NULL;
+    }
+  else
+    {
+      digest = g_string_sized_new (8192);
+      applications_menu_plugin_menu_digest (load->menu, digest);
+      checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, digest->str, digest->len);
+      g_string_free (digest, TRUE);
+
+      /* nothing visible changed, keep the current items */
+      if (plugin->garcon_menu != NULL
+          && plugin->garcon_menu_digest != NULL
+          && strcmp (checksum, plugin->garcon_menu_digest) == 0)
+        {
+          panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "reloaded menu is unchanged");
+          g_free (checksum);
+          return FALSE;
+        }
+    }
+
+  if (panel_debug_has_domain (PANEL_DEBUG_APPLICATIONSMENU))
+    {
+      file = garcon_menu_get_file (load->menu);
+      filename = g_file_get_parse_name (file);
+      g_object_unref (G_OBJECT (file));
+
+      panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
+                   "menu from \"%s\"", filename);
+      g_free (filename);
+    }
+
+  applications_menu_plugin_menu_set (plugin, load->menu, checksum);
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_menu_set (ApplicationsMenuPlugin *plugin,
+                                   GarconMenu             *menu,
+                                   gchar                  *digest)
+{
+  gboolean popup;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_IS_MENU (menu));
+
+  /* replace a placeholder that is popped up with the real menu */
+  popup = (plugin->loading_menu != NULL
+           && GTK_WIDGET_VISIBLE (plugin->loading_menu))
+          || (plugin->snapshot_menu != NULL
+              && GTK_WIDGET_VISIBLE (plugin->snapshot_menu));
+
+  applications_menu_plugin_menu_unset (plugin);
+  applications_menu_plugin_loading_unset (plugin);
+  applications_menu_plugin_snapshot_unset (plugin);
+
+  plugin->garcon_menu = g_object_ref (G_OBJECT (menu));
+  plugin->garcon_menu_digest = digest;
+  g_signal_connect (G_OBJECT (plugin->garcon_menu), "reload-required",
+      G_CALLBACK (applications_menu_plugin_menu_reload_required), plugin);
+
+  garcon_gtk_menu_set_menu (GARCON_GTK_MENU (plugin->menu), plugin->garcon_menu);
+
+  /* create the menu items when the panel is idle */
+  if (popup)
+    applications_menu_plugin_menu (plugin->button, NULL, plugin);
+  else if (plugin->build_idle_id == 0)
+    plugin->build_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+        applications_menu_plugin_menu_build_idle, plugin,
+        applications_menu_plugin_menu_build_idle_destroyed);
+}
+
+
+
+static void
+applications_menu_plugin_menu_load_free (gpointer user_data)
+{
+  ApplicationsMenuLoad *load = user_data;
+
+  g_object_unref (G_OBJECT (load->plugin));
+  g_object_unref (G_OBJECT (load->menu));
+  g_object_unref (G_OBJECT (load->cancellable));
+  if (load->error != NULL)
+    g_error_free (load->error);
+  g_free (load->snapshot_file);
+  g_free (load->snapshot_key);
+  g_strfreev (load->snapshot_roots);
+
+  g_slice_free (ApplicationsMenuLoad, load);
+}
+
+
+
+static gboolean
+applications_menu_plugin_menu_load_job (GIOSchedulerJob *job,
+                                        GCancellable    *cancellable,
+                                        gpointer         user_data)
+{
+  ApplicationsMenuLoad *load = user_data;
+  GError               *error = NULL;
+
+  /* parse the xdg menu files and desktop entries, this runs in a
+   * worker thread (the panel and wrapper initialize gthread), so only
+   * touch the new (private) menu tree and data copied into the load */
+  if (!g_cancellable_is_cancelled (cancellable)
+      && garcon_menu_load (load->menu, cancellable, &load->error)
+      && load->snapshot_file != NULL)
+    {
+      /* write the resolved tree for the next start */
+      if (!applications_menu_snapshot_save (load->menu, load->snapshot_roots,
+                                            load->snapshot_file, load->snapshot_key,
+                                            &error))
+        {
+          g_warning ("Failed to write the menu snapshot \"%s\": %s",
+                     load->snapshot_file, error->message);
+          g_error_free (error);
+        }
+    }
+
+  /* the tree is loaded by now, so garcon-gtk won't parse it again */
+  g_io_scheduler_job_send_to_mainloop_async (job,
+      applications_menu_plugin_menu_load_finished, load,
+      applications_menu_plugin_menu_load_free);
+
+  return FALSE;
+}
+
+
+
+static gchar *
+applications_menu_plugin_snapshot_file (ApplicationsMenuPlugin *plugin,
+                                        gboolean                create)
+{
+  gchar *relpath;
+  gchar *filename;
+
+  relpath = g_strdup_printf (SNAPSHOT_FILE,
+      xfce_panel_plugin_get_unique_id (XFCE_PANEL_PLUGIN (plugin)));
+  if (create)
+    filename = xfce_resource_save_location (XFCE_RESOURCE_CACHE, relpath, TRUE);
+  else
+    /* don't stat on the main thread, the restore job opens it */
+    filename = g_build_filename (g_get_user_cache_dir (), relpath, NULL);
+  g_free (relpath);
+
+  return filename;
+}
+
+
+
+static gchar *
+applications_menu_plugin_snapshot_key (ApplicationsMenuPlugin *plugin)
+{
+  gchar *languages;
+  gchar *key;
+
+  /* everything that selects the menu file and its translations */
+  languages = g_strjoinv (":", (gchar **) g_get_language_names ());
+  key = g_strdup_printf ("%s\n%s\n%s",
+                         plugin->custom_menu && plugin->custom_menu_file != NULL ?
+                         plugin->custom_menu_file : "applications.menu",
+                         exo_str_is_empty (g_getenv ("XDG_MENU_PREFIX")) ?
+                         "" : g_getenv ("XDG_MENU_PREFIX"),
+                         languages);
+  g_free (languages);
+
+  return key;
+}
+
+
+
+static void
+applications_menu_plugin_snapshot_changed (GFileMonitor           *monitor,
+                                           GFile                  *file,
+                                           GFile                  *other_file,
+                                           GFileMonitorEvent       event_type,
+                                           ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  /* only the contents and names of the files matter */
+  if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    return;
+
+  panel_debug (PANEL_DEBUG_APPLICATIONSMENU, "snapshot sources changed, reloading");
+
+  /* parse the tree, it replaces the snapshot when loaded */
+  applications_menu_plugin_menu_load (plugin);
+}
+
+
+
+static gboolean
+applications_menu_plugin_snapshot_restore_finished (gpointer user_data)
+{
+  ApplicationsMenuRestore  *restore = user_data;
+  ApplicationsMenuPlugin   *plugin = restore->plugin;
+  gchar                   **directories;
+  GFile                    *file;
+  GFileMonitor             *monitor;
+  guint                     i;
+
+  /* the plugin is gone or a load replaced this one */
+  if (g_cancellable_is_cancelled (restore->cancellable))
+    return FALSE;
+
+  panel_return_val_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin), FALSE);
+  panel_return_val_if_fail (plugin->load_cancellable == restore->cancellable, FALSE);
+
+  g_object_unref (G_OBJECT (plugin->load_cancellable));
+  plugin->load_cancellable = NULL;
+
+  /* no (valid) snapshot, parse the tree */
+  if (restore->snapshot == NULL)
+    {
+      applications_menu_plugin_menu_load (plugin);
+      return FALSE;
+    }
+
+  plugin->snapshot = restore->snapshot;
+  restore->snapshot = NULL;
+
+  /* the tree is only parsed when one of its sources changes */
+  directories = applications_menu_snapshot_get_directories (plugin->snapshot);
+  for (i = 0; directories[i] != NULL; i++)
+    {
+      file = g_file_new_for_path (directories[i]);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+      if (G_LIKELY (monitor != NULL))
+        {
+          g_signal_connect (G_OBJECT (monitor), "changed",
+              G_CALLBACK (applications_menu_plugin_snapshot_changed), plugin);
+          plugin->snapshot_monitors = g_slist_prepend (plugin->snapshot_monitors, monitor);
+        }
+      g_object_unref (G_OBJECT (file));
+    }
+  g_strfreev (directories);
+
+  /* replace a placeholder that is popped up with the snapshot */
+  if (plugin->loading_menu != NULL
+      && GTK_WIDGET_VISIBLE (plugin->loading_menu))
+    {
+      applications_menu_plugin_loading_unset (plugin);
+      applications_menu_plugin_menu (plugin->button, NULL, plugin);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_snapshot_restore_free (gpointer user_data)
+{
+  ApplicationsMenuRestore *restore = user_data;
+
+  g_object_unref (G_OBJECT (restore->plugin));
+  g_object_unref (G_OBJECT (restore->cancellable));
+  if (restore->snapshot != NULL)
+    applications_menu_snapshot_free (restore->snapshot);
+  g_free (restore->filename);
+  g_free (restore->key);
+
+  g_slice_free (ApplicationsMenuRestore, restore);
+}
+
+
+
+static gboolean
+applications_menu_plugin_snapshot_restore_job (GIOSchedulerJob *job,
+                                               GCancellable    *cancellable,
+                                               gpointer         user_data)
+{
+  ApplicationsMenuRestore *restore = user_data;
+
+  /* map the snapshot and compare the mtimes of all its sources */
+  if (!g_cancellable_is_cancelled (cancellable))
+    restore->snapshot = applications_menu_snapshot_load (restore->filename,
+                                                         restore->key);
+
+  g_io_scheduler_job_send_to_mainloop_async (job,
+      applications_menu_plugin_snapshot_restore_finished, restore,
+      applications_menu_plugin_snapshot_restore_free);
+
+  return FALSE;
+}
+
+
+
+static void
+applications_menu_plugin_snapshot_restore (ApplicationsMenuPlugin *plugin)
+{
+  ApplicationsMenuRestore *restore;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  applications_menu_plugin_menu_load_cancel (plugin);
+
+  /* use the running load slot, so a popup doesn't start a parse */
+  plugin->load_cancellable = g_cancellable_new ();
+
+  restore = g_slice_new0 (ApplicationsMenuRestore);
+  restore->plugin = g_object_ref (G_OBJECT (plugin));
+  restore->cancellable = g_object_ref (G_OBJECT (plugin->load_cancellable));
+  restore->filename = applications_menu_plugin_snapshot_file (plugin, FALSE);
+  restore->key = applications_menu_plugin_snapshot_key (plugin);
+
+  g_io_scheduler_push_job (applications_menu_plugin_snapshot_restore_job, restore,
+                           NULL, G_PRIORITY_DEFAULT, restore->cancellable);
+}
+
+
+
+static void
+applications_menu_plugin_snapshot_unset (ApplicationsMenuPlugin *plugin)
+{
+  GSList *li;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  if (plugin->snapshot_menu != NULL)
+    {
+      /* release the button if the menu is popped up */
+      if (GTK_WIDGET_VISIBLE (plugin->snapshot_menu))
+        applications_menu_plugin_menu_deactivate (plugin->snapshot_menu,
+                                                  plugin->button);
+
+      gtk_widget_destroy (plugin->snapshot_menu);
+      plugin->snapshot_menu = NULL;
+    }
+
+  for (li = plugin->snapshot_monitors; li != NULL; li = li->next)
+    {
+      g_file_monitor_cancel (G_FILE_MONITOR (li->data));
+      g_object_unref (G_OBJECT (li->data));
+    }
+  g_slist_free (plugin->snapshot_monitors);
+  plugin->snapshot_monitors = NULL;
+
+  if (plugin->snapshot != NULL)
+    {
+      applications_menu_snapshot_free (plugin->snapshot);
+      plugin->snapshot = NULL;
+    }
+}
+
+
+
+static GtkWidget *
+applications_menu_plugin_loading_new (ApplicationsMenuPlugin *plugin)
+{
+  GtkWidget *menu;
+  GtkWidget *mi;
+
+  menu = gtk_menu_new ();
+  g_signal_connect (G_OBJECT (menu), "selection-done",
+      G_CALLBACK (applications_menu_plugin_menu_deactivate), plugin->button);
+
+  mi = gtk_menu_item_new_with_label (_("Loading..."));
+  gtk_widget_set_sensitive (mi, FALSE);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
+  gtk_widget_show (mi);
+
+  return menu;
+}
+
+
+
+static void
+applications_menu_plugin_loading_unset (ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  if (plugin->loading_menu != NULL)
+    {
+      /* release the button if the menu is popped up */
+      if (GTK_WIDGET_VISIBLE (plugin->loading_menu))
+        applications_menu_plugin_menu_deactivate (plugin->loading_menu,
+                                                  plugin->button);
+
+      gtk_widget_destroy (plugin->loading_menu);
+      plugin->loading_menu = NULL;
+    }
+}
+
+
+
+static GarconMenu *
+applications_menu_plugin_menu_new (ApplicationsMenuPlugin *plugin)
+{
+  GarconMenu *menu = NULL;
 
   /* load the custom menu if set */
   if (plugin->custom_menu
@@ -741,22 +1344,67 @@ applications_menu_plugin_set_garcon_menu (ApplicationsMenuPlugin *plugin)
   if (G_LIKELY (menu == NULL))
     menu = garcon_menu_new_applications ();
 
-  /* set the menu */
-  garcon_gtk_menu_set_menu (GARCON_GTK_MENU (plugin->menu), menu);
+  return menu;
+}
 
-  /* debugging information */
-  if (0)
-    {
-  file = garcon_menu_get_file (menu);
-  filename = g_file_get_parse_name (file);
-  g_object_unref (G_OBJECT (file));
 
-  panel_debug (PANEL_DEBUG_APPLICATIONSMENU,
-               "menu from \"%s\"", filename);
-  g_free (filename);
+
+static void
+applications_menu_plugin_menu_load_cancel (ApplicationsMenuPlugin *plugin)
+{
+  if (plugin->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (plugin->load_cancellable);
+      g_object_unref (G_OBJECT (plugin->load_cancellable));
+      plugin->load_cancellable = NULL;
     }
+}
+
+
+
+static void
+applications_menu_plugin_menu_load (ApplicationsMenuPlugin *plugin)
+{
+  ApplicationsMenuLoad *load;
+
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+
+  applications_menu_plugin_menu_load_cancel (plugin);
+
+  plugin->load_cancellable = g_cancellable_new ();
+
+  load = g_slice_new0 (ApplicationsMenuLoad);
+  load->plugin = g_object_ref (G_OBJECT (plugin));
+  load->menu = applications_menu_plugin_menu_new (plugin);
+  load->cancellable = g_object_ref (G_OBJECT (plugin->load_cancellable));
+  load->snapshot_file = applications_menu_plugin_snapshot_file (plugin, TRUE);
+  load->snapshot_key = applications_menu_plugin_snapshot_key (plugin);
+  load->snapshot_roots = applications_menu_snapshot_get_roots ();
+
+  g_io_scheduler_push_job (applications_menu_plugin_menu_load_job, load,
+                           NULL, G_PRIORITY_LOW, load->cancellable);
+}
+
+
+
+static void
+applications_menu_plugin_set_garcon_menu (ApplicationsMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_GTK_IS_MENU (plugin->menu));
 
-  g_object_unref (G_OBJECT (menu));
+  /* a different menu file was selected, so always replace the
+   * tree when it is loaded, even if it happens to look the same */
+  g_free (plugin->garcon_menu_digest);
+  plugin->garcon_menu_digest = NULL;
+
+  /* show the snapshot of the last parsed tree if nothing changed,
+   * the tree is then only parsed when one of its sources changes */
+  applications_menu_plugin_snapshot_unset (plugin);
+  if (plugin->garcon_menu == NULL)
+    applications_menu_plugin_snapshot_restore (plugin);
+  else
+    applications_menu_plugin_menu_load (plugin);
 }
 
 
@@ -766,6 +1414,8 @@ applications_menu_plugin_menu (GtkWidget              *button,
                                GdkEventButton         *event,
                                ApplicationsMenuPlugin *plugin)
 {
+  GtkWidget *menu_widget;
+
   panel_return_val_if_fail (XFCE_IS_APPLICATIONS_MENU_PLUGIN (plugin), FALSE);
   panel_return_val_if_fail (button == NULL || plugin->button == button, FALSE);
 
@@ -775,11 +1425,45 @@ applications_menu_plugin_menu (GtkWidget              *button,
            && !PANEL_HAS_FLAG (event->state, GDK_CONTROL_MASK)))
     return FALSE;
 
+  menu_widget = plugin->menu;
+
+  /* never parse the tree next to the background load or restore,
+   * show a placeholder until the job finishes and replaces it */
+  if (plugin->garcon_menu == NULL
+      && plugin->snapshot == NULL
+      && plugin->load_cancellable == NULL)
+    applications_menu_plugin_menu_load (plugin);
+
+  /* show the menu from the snapshot until the tree is parsed */
+  if (plugin->garcon_menu == NULL
+      && plugin->snapshot != NULL)
+    {
+      if (plugin->snapshot_menu == NULL)
+        {
+          plugin->snapshot_menu = applications_menu_snapshot_create_menu (plugin->snapshot,
+              garcon_gtk_menu_get_show_generic_names (GARCON_GTK_MENU (plugin->menu)),
+              garcon_gtk_menu_get_show_menu_icons (GARCON_GTK_MENU (plugin->menu)),
+              garcon_gtk_menu_get_show_tooltips (GARCON_GTK_MENU (plugin->menu)));
+          g_signal_connect (G_OBJECT (plugin->snapshot_menu), "selection-done",
+              G_CALLBACK (applications_menu_plugin_menu_deactivate), plugin->button);
+        }
+
+      menu_widget = plugin->snapshot_menu;
+    }
+
+  else if (G_UNLIKELY (plugin->garcon_menu == NULL))
+    {
+      if (plugin->loading_menu == NULL)
+        plugin->loading_menu = applications_menu_plugin_loading_new (plugin);
+
+      menu_widget = plugin->loading_menu;
+    }
+
   if (button != NULL)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
 
   /* show the menu */
-  gtk_menu_popup (GTK_MENU (plugin->menu), NULL, NULL,
+  gtk_menu_popup (GTK_MENU (menu_widget), NULL, NULL,
                   button != NULL ? xfce_panel_plugin_position_menu : NULL,
                   plugin, 1,
                   event != NULL ? event->time : gtk_get_current_event_time ());
@@ -19,6 +19,9 @@
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
 
 #include <gio/gio.h>
 #include <exo/exo.h>
@@ -37,7 +40,34 @@
 #include "directorymenu-dialog_ui.h"
 
 #define DEFAULT_ICON_NAME "folder"
+#define LOAD_BATCH_SIZE   (64)
+#define MAX_LISTINGS      (16)
+#define ENUMERATE_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME \
+                             "," G_FILE_ATTRIBUTE_STANDARD_NAME \
+                             "," G_FILE_ATTRIBUTE_STANDARD_TYPE \
+                             "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN \
+                             "," G_FILE_ATTRIBUTE_STANDARD_ICON
+
+
+typedef struct
+{
+  /* "*" in the patterns */
+  guint       match_all : 1;
 
+  /* exact file names */
+  GHashTable *literals;
+
+  /* extensions of "*.ext" patterns */
+  GHashTable *extensions;
+
+  /* "prefix*" and "*suffix" patterns */
+  GPtrArray  *prefixes;
+  GPtrArray  *suffixes;
+
+  /* all other patterns */
+  GSList     *globs;
+}
+DirectoryMenuPatterns;
 
 struct _DirectoryMenuPluginClass
 {
@@ -56,13 +86,61 @@ struct _DirectoryMenuPlugin
   gchar           *file_pattern;
   guint            hidden_files : 1;
 
-  GSList          *patterns;
+  DirectoryMenuPatterns *patterns;
+
+  /* cached directory listings, by directory uri */
+  GHashTable      *listings;
+  GQueue          *listings_lru;
 
   /* temp item we store here when the
    * properties dialog is opened */
   GtkWidget       *dialog_icon;
 };
 
+typedef struct
+{
+  DirectoryMenuPlugin *plugin;
+  GtkWidget           *menu;
+  GFile               *dir;
+  GCancellable        *cancellable;
+
+  /* sorted file infos in the menu */
+  GPtrArray           *infos;
+
+  /* number of menu items before the first file */
+  guint                n_header;
+
+  /* watches the directory while loading, the listing is
+   * only cached if nothing changed in the meantime */
+  GFileMonitor        *monitor;
+  guint                changed : 1;
+}
+DirectoryMenuLoad;
+
+typedef struct
+{
+  DirectoryMenuLoad   *load;
+  GFileEnumerator     *iter;
+
+  /* visible files of a batch with desktop files, which
+   * are parsed in a thread before the batch is inserted */
+  GPtrArray           *batch;
+}
+DirectoryMenuParse;
+
+typedef struct
+{
+  DirectoryMenuPlugin *plugin;
+  gchar               *uri;
+
+  /* sorted and filtered file infos */
+  GPtrArray           *infos;
+
+  /* the listing is dropped on the first change */
+  GFileMonitor        *monitor;
+}
+DirectoryMenuListing;
+
 enum
 {
   PROP_0,
@@ -83,7 +161,11 @@ static void      directory_menu_plugin_set_property         (GObject
                                                              const GValue        *value,
                                                              GParamSpec          *pspec);
 static void      directory_menu_plugin_construct            (XfcePanelPlugin     *panel_plugin);
+static DirectoryMenuPatterns *directory_menu_plugin_patterns_new (gchar **array);
+static void      directory_menu_plugin_patterns_free        (DirectoryMenuPatterns *patterns);
 static void      directory_menu_plugin_free_file_patterns   (DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_listing_free         (gpointer             data);
+static void      directory_menu_plugin_listings_clear       (DirectoryMenuPlugin *plugin);
 static void      directory_menu_plugin_free_data            (XfcePanelPlugin     *panel_plugin);
 static gboolean  directory_menu_plugin_size_changed         (XfcePanelPlugin     *panel_plugin,
                                                              gint                 size);
@@ -93,6 +175,11 @@ static gboolean  directory_menu_plugin_remote_event         (XfcePanelPlugin
                                                              const GValue        *value);
 static void      directory_menu_plugin_menu                 (GtkWidget           *button,
                                                              DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_menu_load            (GtkWidget           *menu,
+                                                             DirectoryMenuPlugin *plugin);
+static void      directory_menu_plugin_menu_load_next       (GObject             *source_object,
+                                                             GAsyncResult        *result,
+                                                             gpointer             user_data);
 
 
 
@@ -102,6 +189,10 @@ XFCE_PANEL_DEFINE_PLUGIN (DirectoryMenuPlugin, directory_menu_plugin)
 
 
 static GQuark menu_file = 0;
+static GQuark menu_load = 0;
+#ifdef HAVE_GIO_UNIX
+static GQuark menu_desktop_info = 0;
+#endif
 static GtkIconSize menu_icon_size = GTK_ICON_SIZE_INVALID;
 
 
@@ -151,6 +242,10 @@ directory_menu_plugin_class_init (DirectoryMenuPluginClass *klass)
                                                          EXO_PARAM_READWRITE));
 
   menu_file = g_quark_from_static_string ("dir-menu-file");
+  menu_load = g_quark_from_static_string ("dir-menu-load");
+#ifdef HAVE_GIO_UNIX
+  menu_desktop_info = g_quark_from_static_string ("dir-menu-desktop-info");
+#endif
 
   menu_icon_size = gtk_icon_size_from_name ("panel-directory-menu");
   if (menu_icon_size == GTK_ICON_SIZE_INVALID)
@@ -162,6 +257,10 @@ directory_menu_plugin_class_init (DirectoryMenuPluginClass *klass)
 static void
 directory_menu_plugin_init (DirectoryMenuPlugin *plugin)
 {
+  plugin->listings = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                            directory_menu_plugin_listing_free);
+  plugin->listings_lru = g_queue_new ();
+
   plugin->button = xfce_panel_create_toggle_button ();
   xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (plugin), plugin->button);
   gtk_container_add (GTK_CONTAINER (plugin), plugin->button);
@@ -226,7 +325,6 @@ directory_menu_plugin_set_property (GObject      *object,
   DirectoryMenuPlugin  *plugin = XFCE_DIRECTORY_MENU_PLUGIN (object);
   gchar                *display_name;
   gchar               **array;
-  guint                 i;
   const gchar          *path;
 
   switch (prop_id)
@@ -260,21 +358,19 @@ directory_menu_plugin_set_property (GObject      *object,
       plugin->file_pattern = g_value_dup_string (value);
 
       directory_menu_plugin_free_file_patterns (plugin);
+      directory_menu_plugin_listings_clear (plugin);
 
       array = g_strsplit (plugin->file_pattern, ";", -1);
       if (G_LIKELY (array != NULL))
         {
-          for (i = 0; array[i] != NULL; i++)
-            if (!exo_str_is_empty (array[i]))
-                plugin->patterns = g_slist_prepend (plugin->patterns,
-                    g_pattern_spec_new (array[i]));
-
+          plugin->patterns = directory_menu_plugin_patterns_new (array);
           g_strfreev (array);
         }
       break;
 
     case PROP_HIDDEN_FILES:
       plugin->hidden_files = g_value_get_boolean (value);
+      directory_menu_plugin_listings_clear (plugin);
       break;
 
     default:
@@ -315,18 +411,284 @@ directory_menu_plugin_construct (XfcePanelPlugin *panel_plugin)
 
 
 
+static DirectoryMenuPatterns *
+directory_menu_plugin_patterns_new (gchar **array)
+{
+  DirectoryMenuPatterns *patterns;
+  guint                  i;
+  const gchar           *pattern;
+  gsize                  len;
+  gboolean               any = FALSE;
+
+  patterns = g_slice_new0 (DirectoryMenuPatterns);
+  patterns->literals = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  patterns->extensions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  patterns->prefixes = g_ptr_array_new ();
+  patterns->suffixes = g_ptr_array_new ();
+
+  for (i = 0; array[i] != NULL; i++)
+    {
+      pattern = array[i];
+      if (exo_str_is_empty (pattern))
+        continue;
+
+      any = TRUE;
+      len = strlen (pattern);
+
+      if (strcmp (pattern, "*") == 0)
+        {
+          patterns->match_all = TRUE;
+        }
+      else if (strpbrk (pattern, "*?") == NULL)
+        {
+          g_hash_table_insert (patterns->literals, g_strdup (pattern),
+                               GINT_TO_POINTER (TRUE));
+        }
+      else if (pattern[0] == '*'
+               && strpbrk (pattern + 1, "*?") == NULL)
+        {
+          /* put the common "*.ext" in a table, other suffixes in a list */
+          if (pattern[1] == '.' && strchr (pattern + 2, '.') == NULL)
+            g_hash_table_insert (patterns->extensions, g_strdup (pattern + 2),
+                                 GINT_TO_POINTER (TRUE));
+          else
+            g_ptr_array_add (patterns->suffixes, g_strdup (pattern + 1));
+        }
+      else if (pattern[len - 1] == '*'
+               && strcspn (pattern, "*?") == len - 1)
+        {
+          g_ptr_array_add (patterns->prefixes, g_strndup (pattern, len - 1));
+        }
+      else
+        {
+          patterns->globs = g_slist_prepend (patterns->globs,
+                                             g_pattern_spec_new (pattern));
+        }
+    }
+
+  if (!any)
+    {
+      directory_menu_plugin_patterns_free (patterns);
+      return NULL;
+    }
+
+  return patterns;
+}
+
+
+
+static void
+directory_menu_plugin_patterns_free (DirectoryMenuPatterns *patterns)
+{
+  g_hash_table_destroy (patterns->literals);
+  g_hash_table_destroy (patterns->extensions);
+
+  g_ptr_array_foreach (patterns->prefixes, (GFunc) g_free, NULL);
+  g_ptr_array_free (patterns->prefixes, TRUE);
+  g_ptr_array_foreach (patterns->suffixes, (GFunc) g_free, NULL);
+  g_ptr_array_free (patterns->suffixes, TRUE);
+
+  g_slist_foreach (patterns->globs, (GFunc) g_pattern_spec_free, NULL);
+  g_slist_free (patterns->globs);
+
+  g_slice_free (DirectoryMenuPatterns, patterns);
+}
+
+
+
+static gboolean
+directory_menu_plugin_patterns_match (DirectoryMenuPatterns *patterns,
+                                      const gchar           *name)
+{
+  const gchar *ext;
+  const gchar *str;
+  gsize        len, n;
+  guint        i;
+  GSList      *li;
+
+  if (patterns->match_all)
+    return TRUE;
+
+  /* extension of the file name */
+  ext = strrchr (name, '.');
+  if (ext != NULL
+      && g_hash_table_size (patterns->extensions) > 0
+      && g_hash_table_lookup (patterns->extensions, ext + 1) != NULL)
+    return TRUE;
+
+  if (g_hash_table_size (patterns->literals) > 0
+      && g_hash_table_lookup (patterns->literals, name) != NULL)
+    return TRUE;
+
+  len = strlen (name);
+
+  for (i = 0; i < patterns->suffixes->len; i++)
+    {
+      str = g_ptr_array_index (patterns->suffixes, i);
+      n = strlen (str);
+      if (n <= len && memcmp (name + len - n, str, n) == 0)
+        return TRUE;
+    }
+
+  for (i = 0; i < patterns->prefixes->len; i++)
+    {
+      str = g_ptr_array_index (patterns->prefixes, i);
+      if (strncmp (name, str, strlen (str)) == 0)
+        return TRUE;
+    }
+
+  /* complex globs */
+  for (li = patterns->globs; li != NULL; li = li->next)
+    if (g_pattern_match (li->data, len, name, NULL))
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
 static void
 directory_menu_plugin_free_file_patterns (DirectoryMenuPlugin *plugin)
 {
-  GSList *li;
+  panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
+
+  if (plugin->patterns != NULL)
+    {
+      directory_menu_plugin_patterns_free (plugin->patterns);
+      plugin->patterns = NULL;
+    }
+}
 
+
+
+static void
+directory_menu_plugin_listing_free (gpointer data)
+{
+  DirectoryMenuListing *listing = data;
+
+  g_signal_handlers_disconnect_matched (G_OBJECT (listing->monitor),
+      G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, listing);
+  g_file_monitor_cancel (listing->monitor);
+  g_object_unref (G_OBJECT (listing->monitor));
+
+  g_ptr_array_foreach (listing->infos, (GFunc) g_object_unref, NULL);
+  g_ptr_array_free (listing->infos, TRUE);
+
+  g_free (listing->uri);
+  g_slice_free (DirectoryMenuListing, listing);
+}
+
+
+
+static gboolean
+directory_menu_plugin_listing_event (GFile             *file,
+                                     GFileMonitorEvent  event_type)
+{
+  gchar    *basename;
+  gboolean  result;
+
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGED
+      && event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+    return TRUE;
+
+  basename = g_file_get_basename (file);
+  result = basename != NULL && g_str_has_suffix (basename, ".desktop");
+  g_free (basename);
+
+  return result;
+}
+
+
+
+static void
+directory_menu_plugin_listing_changed (GFileMonitor         *monitor,
+                                       GFile                *file,
+                                       GFile                *other_file,
+                                       GFileMonitorEvent     event_type,
+                                       DirectoryMenuListing *listing)
+{
+  DirectoryMenuPlugin *plugin = listing->plugin;
+
+  /* content changes don't change the listing, except for the
+   * parsed desktop files */
+  if (!directory_menu_plugin_listing_event (file, event_type))
+    return;
+
+  g_queue_remove (plugin->listings_lru, listing);
+  g_hash_table_remove (plugin->listings, listing->uri);
+}
+
+
+
+static void
+directory_menu_plugin_listings_clear (DirectoryMenuPlugin *plugin)
+{
   panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
 
-  for (li = plugin->patterns; li != NULL; li = li->next)
-    g_pattern_spec_free (li->data);
+  /* the listings contain the filter result, so they are dropped
+   * when the patterns or the hidden files setting change */
+  g_queue_clear (plugin->listings_lru);
+  g_hash_table_remove_all (plugin->listings);
+}
+
+
+
+static DirectoryMenuListing *
+directory_menu_plugin_listing_lookup (DirectoryMenuPlugin *plugin,
+                                      GFile               *dir)
+{
+  DirectoryMenuListing *listing;
+  gchar                *uri;
+
+  uri = g_file_get_uri (dir);
+  listing = g_hash_table_lookup (plugin->listings, uri);
+  g_free (uri);
 
-  g_slist_free (plugin->patterns);
-  plugin->patterns = NULL;
+  /* move to the front of the lru */
+  if (listing != NULL)
+    {
+      g_queue_remove (plugin->listings_lru, listing);
+      g_queue_push_head (plugin->listings_lru, listing);
+    }
+
+  return listing;
+}
+
+
+
+static void
+directory_menu_plugin_listing_store (DirectoryMenuPlugin *plugin,
+                                     GFile               *dir,
+                                     GPtrArray           *infos,
+                                     GFileMonitor        *monitor)
+{
+  DirectoryMenuListing *listing;
+
+  listing = g_slice_new0 (DirectoryMenuListing);
+  listing->plugin = plugin;
+  listing->uri = g_file_get_uri (dir);
+  listing->infos = infos;
+  listing->monitor = monitor;
+  g_signal_connect (G_OBJECT (monitor), "changed",
+      G_CALLBACK (directory_menu_plugin_listing_changed), listing);
+
+  /* replace a listing of the same directory */
+  if (g_hash_table_lookup (plugin->listings, listing->uri) != NULL)
+    {
+      g_queue_remove (plugin->listings_lru,
+                      g_hash_table_lookup (plugin->listings, listing->uri));
+      g_hash_table_remove (plugin->listings, listing->uri);
+    }
+
+  g_hash_table_insert (plugin->listings, listing->uri, listing);
+  g_queue_push_head (plugin->listings_lru, listing);
+
+  /* drop the least recently used directories */
+  while (g_queue_get_length (plugin->listings_lru) > MAX_LISTINGS)
+    {
+      listing = g_queue_pop_tail (plugin->listings_lru);
+      g_hash_table_remove (plugin->listings, listing->uri);
+    }
 }
 
 
@@ -341,6 +703,12 @@ directory_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
   g_free (plugin->file_pattern);
 
   directory_menu_plugin_free_file_patterns (plugin);
+
+  directory_menu_plugin_listings_clear (plugin);
+  g_hash_table_destroy (plugin->listings);
+  plugin->listings = NULL;
+  g_queue_free (plugin->listings_lru);
+  plugin->listings_lru = NULL;
 }
 
 
@@ -509,6 +877,9 @@ directory_menu_plugin_selection_done (GtkWidget *menu,
   if (button != NULL)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), FALSE);
 
+  /* stop a running load */
+  g_object_set_qdata (G_OBJECT (menu), menu_load, NULL);
+
   /* delay destruction so we can handle the activate event first */
   exo_gtk_object_destroy_later (GTK_OBJECT (menu));
 }
@@ -545,6 +916,16 @@ directory_menu_plugin_menu_sort (gconstpointer a,
 
 
 
+static gint
+directory_menu_plugin_menu_sort_array (gconstpointer a,
+                                       gconstpointer b)
+{
+  return directory_menu_plugin_menu_sort (*((gconstpointer *) a),
+                                          *((gconstpointer *) b));
+}
+
+
+
 #ifdef HAVE_GIO_UNIX
 static void
 directory_menu_plugin_menu_launch_desktop_file (GtkWidget *mi,
@@ -573,6 +954,59 @@ directory_menu_plugin_menu_launch_desktop_file (GtkWidget *mi,
 
   g_object_unref (G_OBJECT (context));
 }
+
+
+
+static gboolean
+directory_menu_plugin_menu_is_desktop_file (GFile     *dir,
+                                            GFileInfo *info)
+{
+  /* for native desktop files we make an exception and try to load them
+   * like a normal menu, they are parsed before the item is inserted */
+  return g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY
+         && g_file_is_native (dir)
+         && g_str_has_suffix (g_file_info_get_display_name (info), ".desktop");
+}
+
+
+
+static gboolean
+directory_menu_plugin_menu_desktop_info (GFile     *dir,
+                                         GFileInfo *info)
+{
+  GDesktopAppInfo *desktopinfo;
+  GFile           *file;
+  gchar           *path;
+  const gchar     *name;
+
+  /* this runs in a thread, so only the info is modified */
+  if (!directory_menu_plugin_menu_is_desktop_file (dir, info))
+    return TRUE;
+
+  file = g_file_get_child (dir, g_file_info_get_name (info));
+  path = g_file_get_path (file);
+  desktopinfo = g_desktop_app_info_new_from_filename (path);
+  g_object_unref (G_OBJECT (file));
+  g_free (path);
+
+  /* the item acts like a normal file if parsing failed */
+  if (G_UNLIKELY (desktopinfo == NULL))
+    return TRUE;
+
+  /* hide invalid or hidden files */
+  name = g_app_info_get_name (G_APP_INFO (desktopinfo));
+  if (exo_str_is_empty (name)
+      || g_desktop_app_info_get_is_hidden (desktopinfo))
+    {
+      g_object_unref (G_OBJECT (desktopinfo));
+      return FALSE;
+    }
+
+  g_object_set_qdata_full (G_OBJECT (info), menu_desktop_info,
+                           desktopinfo, g_object_unref);
+
+  return TRUE;
+}
 #endif
 
 
@@ -581,6 +1015,9 @@ static void
 directory_menu_plugin_menu_launch (GtkWidget *mi,
                                    GFile     *file)
 {
+#ifdef HAVE_GIO_UNIX
+  GDesktopAppInfo     *desktopinfo;
+#endif
   GAppInfo            *appinfo;
   GError              *error = NULL;
   gchar               *display_name;
@@ -593,6 +1030,16 @@ directory_menu_plugin_menu_launch (GtkWidget *mi,
   panel_return_if_fail (G_IS_FILE (file));
   panel_return_if_fail (GTK_IS_WIDGET (mi));
 
+#ifdef HAVE_GIO_UNIX
+  /* launch desktop files that were shown in the menu like applications */
+  desktopinfo = g_object_get_qdata (G_OBJECT (mi), menu_desktop_info);
+  if (desktopinfo != NULL)
+    {
+      directory_menu_plugin_menu_launch_desktop_file (mi, G_APP_INFO (desktopinfo));
+      return;
+    }
+#endif
+
   info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
                             G_FILE_QUERY_INFO_NONE, NULL, &error);
   if (G_UNLIKELY (info == NULL))
@@ -749,6 +1196,9 @@ directory_menu_plugin_menu_open_folder (GtkWidget *mi,
 static void
 directory_menu_plugin_menu_unload (GtkWidget *menu)
 {
+  /* stop a running load */
+  g_object_set_qdata (G_OBJECT (menu), menu_load, NULL);
+
   /* delay destruction so we can handle the activate event first */
   gtk_container_foreach (GTK_CONTAINER (menu),
      (GtkCallback) exo_gtk_object_destroy_later, NULL);
@@ -757,27 +1207,416 @@ directory_menu_plugin_menu_unload (GtkWidget *menu)
 
 
 static void
-directory_menu_plugin_menu_load (GtkWidget           *menu,
-                                 DirectoryMenuPlugin *plugin)
+directory_menu_plugin_menu_load_cancel (gpointer data)
+{
+  g_cancellable_cancel (G_CANCELLABLE (data));
+  g_object_unref (G_OBJECT (data));
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_changed (GFileMonitor      *monitor,
+                                         GFile             *file,
+                                         GFile             *other_file,
+                                         GFileMonitorEvent  event_type,
+                                         DirectoryMenuLoad *load)
+{
+  if (directory_menu_plugin_listing_event (file, event_type))
+    load->changed = TRUE;
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_free (DirectoryMenuLoad *load,
+                                      gboolean           complete)
+{
+  /* only clear the menu data if it still belongs to this load */
+  if (g_object_get_qdata (G_OBJECT (load->menu), menu_load) == load->cancellable)
+    g_object_set_qdata (G_OBJECT (load->menu), menu_load, NULL);
+
+  if (load->monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (load->monitor),
+          directory_menu_plugin_menu_load_changed, load);
+
+      /* cache the listing if the directory did not change while loading */
+      if (complete && !load->changed && load->plugin->listings != NULL)
+        {
+          directory_menu_plugin_listing_store (load->plugin, load->dir,
+                                               load->infos, load->monitor);
+          load->infos = NULL;
+        }
+      else
+        {
+          g_file_monitor_cancel (load->monitor);
+          g_object_unref (G_OBJECT (load->monitor));
+        }
+    }
+
+  if (load->infos != NULL)
+    {
+      g_ptr_array_foreach (load->infos, (GFunc) g_object_unref, NULL);
+      g_ptr_array_free (load->infos, TRUE);
+    }
+
+  g_object_unref (G_OBJECT (load->cancellable));
+  g_object_unref (G_OBJECT (load->dir));
+  g_object_unref (G_OBJECT (load->menu));
+  g_object_unref (G_OBJECT (load->plugin));
+  g_slice_free (DirectoryMenuLoad, load);
+}
+
+
+
+static gboolean
+directory_menu_plugin_menu_visible (DirectoryMenuPlugin *plugin,
+                                    GFileInfo           *info)
+{
+  const gchar *display_name;
+
+  /* skip hidden files if disabled by the user */
+  if (!plugin->hidden_files
+      && g_file_info_get_is_hidden (info))
+    return FALSE;
+
+  display_name = g_file_info_get_display_name (info);
+  if (G_UNLIKELY (display_name == NULL))
+    return FALSE;
+
+  /* directories are always shown */
+  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+    return TRUE;
+
+  /* if the file is not a directory, check the file patterns */
+  return plugin->patterns != NULL
+         && directory_menu_plugin_patterns_match (plugin->patterns, display_name);
+}
+
+
+
+static GtkWidget *
+directory_menu_plugin_menu_item_new (DirectoryMenuPlugin *plugin,
+                                     GFile               *dir,
+                                     GFileInfo           *info)
 {
-  GFileEnumerator *iter;
-  GFileInfo       *info;
   GtkWidget       *mi;
-  const gchar     *display_name;
-  GSList          *li, *infos = NULL;
-  GIcon           *icon;
   GtkWidget       *image;
   GtkWidget       *submenu;
   GFile           *file;
-  GFile           *dir;
-  gboolean         visible;
-  GFileType        file_type;
+  GIcon           *icon;
+  const gchar     *display_name;
 #ifdef HAVE_GIO_UNIX
   GDesktopAppInfo *desktopinfo;
-  gchar           *path;
-  const gchar     *description;
+  const gchar     *description = NULL;
+#endif
+
+  display_name = g_file_info_get_display_name (info);
+  file = g_file_get_child (dir, g_file_info_get_name (info));
+  icon = g_file_info_get_icon (info);
+
+#ifdef HAVE_GIO_UNIX
+  /* desktop files parsed by directory_menu_plugin_menu_desktop_info */
+  desktopinfo = g_object_get_qdata (G_OBJECT (info), menu_desktop_info);
+  if (G_UNLIKELY (desktopinfo != NULL))
+    {
+      display_name = g_app_info_get_name (G_APP_INFO (desktopinfo));
+      description = g_app_info_get_description (G_APP_INFO (desktopinfo));
+      icon = g_app_info_get_icon (G_APP_INFO (desktopinfo));
+    }
+#endif
+
+  mi = gtk_image_menu_item_new_with_label (display_name);
+  gtk_widget_show (mi);
+
+  if (G_LIKELY (icon != NULL))
+    {
+      image = gtk_image_new_from_gicon (icon, menu_icon_size);
+      gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+      gtk_widget_show (image);
+    }
+
+  /* set a submenu for directories */
+  if (G_LIKELY (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY))
+    {
+      submenu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (mi), submenu);
+      g_object_set_qdata_full (G_OBJECT (submenu), menu_file, file, g_object_unref);
+
+      g_signal_connect (G_OBJECT (submenu), "show",
+          G_CALLBACK (directory_menu_plugin_menu_load), plugin);
+      g_signal_connect_after (G_OBJECT (submenu), "hide",
+          G_CALLBACK (directory_menu_plugin_menu_unload), NULL);
+
+      return mi;
+    }
+
+#ifdef HAVE_GIO_UNIX
+  if (G_UNLIKELY (desktopinfo != NULL))
+    {
+      g_object_set_qdata_full (G_OBJECT (mi), menu_desktop_info,
+                               g_object_ref (G_OBJECT (desktopinfo)), g_object_unref);
+      if (!exo_str_is_empty (description))
+        gtk_widget_set_tooltip_text (mi, description);
+    }
+#endif
+
+  g_signal_connect_data (G_OBJECT (mi), "activate",
+      G_CALLBACK (directory_menu_plugin_menu_launch), file,
+      (GClosureNotify) g_object_unref, 0);
+
+  return mi;
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_batch (DirectoryMenuLoad *load,
+                                       GPtrArray         *batch)
+{
+  GPtrArray *merged;
+  guint      i, j;
+  gpointer   info;
+  GtkWidget *mi;
+
+  if (batch->len == 0)
+    return;
+
+  /* add the separator before the first file */
+  if (load->infos->len == 0)
+    {
+      mi = gtk_separator_menu_item_new ();
+      gtk_menu_shell_append (GTK_MENU_SHELL (load->menu), mi);
+      gtk_widget_show (mi);
+      load->n_header++;
+    }
+
+  /* g_ptr_array_sort is a merge sort */
+  g_ptr_array_sort (batch, directory_menu_plugin_menu_sort_array);
+
+  /* merge the batch in the sorted infos and insert the new menu
+   * items at their final position */
+  merged = g_ptr_array_sized_new (load->infos->len + batch->len);
+  for (i = 0, j = 0; i < load->infos->len || j < batch->len;)
+    {
+      if (j >= batch->len
+          || (i < load->infos->len
+              && directory_menu_plugin_menu_sort (g_ptr_array_index (load->infos, i),
+                                                  g_ptr_array_index (batch, j)) <= 0))
+        {
+          g_ptr_array_add (merged, g_ptr_array_index (load->infos, i++));
+        }
+      else
+        {
+          info = g_ptr_array_index (batch, j++);
+          mi = directory_menu_plugin_menu_item_new (load->plugin, load->dir, info);
+          gtk_menu_shell_insert (GTK_MENU_SHELL (load->menu), mi,
+                                 load->n_header + merged->len);
+          g_ptr_array_add (merged, info);
+        }
+    }
+
+  g_ptr_array_free (load->infos, TRUE);
+  load->infos = merged;
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_finish (DirectoryMenuLoad *load,
+                                        GFileEnumerator   *iter,
+                                        gboolean           complete)
+{
+  /* done or cancelled, close without blocking */
+  g_file_enumerator_close_async (iter, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+  g_object_unref (G_OBJECT (iter));
+
+  directory_menu_plugin_menu_load_free (load, complete);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_continue (DirectoryMenuLoad *load,
+                                          GFileEnumerator   *iter)
+{
+  /* request the next batch */
+  g_file_enumerator_next_files_async (iter, LOAD_BATCH_SIZE, G_PRIORITY_DEFAULT,
+                                      load->cancellable,
+                                      directory_menu_plugin_menu_load_next, load);
+}
+
+
+
+#ifdef HAVE_GIO_UNIX
+static gboolean
+directory_menu_plugin_menu_load_parsed (gpointer user_data)
+{
+  DirectoryMenuParse *parse = user_data;
+
+  GDK_THREADS_ENTER ();
+
+  if (g_cancellable_is_cancelled (parse->load->cancellable))
+    {
+      g_ptr_array_foreach (parse->batch, (GFunc) g_object_unref, NULL);
+      directory_menu_plugin_menu_load_finish (parse->load, parse->iter, FALSE);
+    }
+  else
+    {
+      directory_menu_plugin_menu_load_batch (parse->load, parse->batch);
+      directory_menu_plugin_menu_load_continue (parse->load, parse->iter);
+    }
+
+  GDK_THREADS_LEAVE ();
+
+  g_ptr_array_free (parse->batch, TRUE);
+  g_slice_free (DirectoryMenuParse, parse);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+directory_menu_plugin_menu_load_parse (GIOSchedulerJob *job,
+                                       GCancellable    *cancellable,
+                                       gpointer         user_data)
+{
+  DirectoryMenuParse *parse = user_data;
+  guint               i;
+  GFileInfo          *info;
+
+  /* parse the desktop files off the main loop, this can take a
+   * while for large or remote (but native) directories; hidden
+   * ones are removed, so they never show up in the menu */
+  for (i = parse->batch->len; i > 0; i--)
+    {
+      if (g_cancellable_is_cancelled (parse->load->cancellable))
+        break;
+
+      info = g_ptr_array_index (parse->batch, i - 1);
+      if (!directory_menu_plugin_menu_desktop_info (parse->load->dir, info))
+        {
+          g_ptr_array_remove_index (parse->batch, i - 1);
+          g_object_unref (G_OBJECT (info));
+        }
+    }
+
+  g_io_scheduler_job_send_to_mainloop_async (job,
+      directory_menu_plugin_menu_load_parsed, parse, NULL);
+
+  return FALSE;
+}
 #endif
 
+
+
+static void
+directory_menu_plugin_menu_load_next (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  DirectoryMenuLoad  *load = user_data;
+  GFileEnumerator    *iter = G_FILE_ENUMERATOR (source_object);
+  GList              *files, *li;
+  GPtrArray          *batch;
+  GError             *error = NULL;
+  gboolean            complete;
+#ifdef HAVE_GIO_UNIX
+  gboolean            has_desktop_files = FALSE;
+  DirectoryMenuParse *parse;
+#endif
+
+  files = g_file_enumerator_next_files_finish (iter, result, &error);
+  if (files == NULL || g_cancellable_is_cancelled (load->cancellable))
+    {
+      /* the listing is complete if we reached the end without errors */
+      complete = (files == NULL && error == NULL);
+      if (error != NULL)
+        g_error_free (error);
+
+      g_list_foreach (files, (GFunc) g_object_unref, NULL);
+      g_list_free (files);
+
+      directory_menu_plugin_menu_load_finish (load, iter, complete);
+      return;
+    }
+
+  batch = g_ptr_array_sized_new (LOAD_BATCH_SIZE);
+  for (li = files; li != NULL; li = li->next)
+    {
+      if (directory_menu_plugin_menu_visible (load->plugin, li->data))
+        {
+          g_ptr_array_add (batch, li->data);
+#ifdef HAVE_GIO_UNIX
+          if (!has_desktop_files)
+            has_desktop_files = directory_menu_plugin_menu_is_desktop_file (load->dir, li->data);
+#endif
+        }
+      else
+        {
+          g_object_unref (G_OBJECT (li->data));
+        }
+    }
+  g_list_free (files);
+
+#ifdef HAVE_GIO_UNIX
+  if (has_desktop_files)
+    {
+      /* the batch is inserted when its desktop files are parsed */
+      parse = g_slice_new0 (DirectoryMenuParse);
+      parse->load = load;
+      parse->iter = iter;
+      parse->batch = batch;
+      g_io_scheduler_push_job (directory_menu_plugin_menu_load_parse, parse,
+                               NULL, G_PRIORITY_DEFAULT, NULL);
+      return;
+    }
+#endif
+
+  GDK_THREADS_ENTER ();
+  directory_menu_plugin_menu_load_batch (load, batch);
+  GDK_THREADS_LEAVE ();
+
+  g_ptr_array_free (batch, TRUE);
+
+  directory_menu_plugin_menu_load_continue (load, iter);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load_enumerate (GObject      *source_object,
+                                           GAsyncResult *result,
+                                           gpointer      user_data)
+{
+  DirectoryMenuLoad *load = user_data;
+  GFileEnumerator   *iter;
+
+  iter = g_file_enumerate_children_finish (G_FILE (source_object), result, NULL);
+  if (G_UNLIKELY (iter == NULL))
+    {
+      directory_menu_plugin_menu_load_free (load, FALSE);
+      return;
+    }
+
+  directory_menu_plugin_menu_load_continue (load, iter);
+}
+
+
+
+static void
+directory_menu_plugin_menu_load (GtkWidget           *menu,
+                                 DirectoryMenuPlugin *plugin)
+{
+  GtkWidget            *mi;
+  GtkWidget            *image;
+  GFile                *dir;
+  DirectoryMenuLoad    *load;
+  DirectoryMenuListing *listing;
+  guint                 i;
+
   panel_return_if_fail (XFCE_IS_DIRECTORY_MENU_PLUGIN (plugin));
   panel_return_if_fail (GTK_IS_MENU (menu));
 
@@ -808,159 +1647,53 @@ directory_menu_plugin_menu_load (GtkWidget           *menu,
   gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
   gtk_widget_show (image);
 
-  iter = g_file_enumerate_children (dir, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME
-                                    "," G_FILE_ATTRIBUTE_STANDARD_NAME
-                                    "," G_FILE_ATTRIBUTE_STANDARD_TYPE
-                                    "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN
-                                    "," G_FILE_ATTRIBUTE_STANDARD_ICON,
-                                    G_FILE_QUERY_INFO_NONE, NULL, NULL);
-  if (G_LIKELY (iter != NULL))
+  /* use the cached listing if the directory did not change */
+  listing = directory_menu_plugin_listing_lookup (plugin, dir);
+  if (listing != NULL)
     {
-      for (;;)
-        {
-          info = g_file_enumerator_next_file (iter, NULL, NULL);
-          if (G_UNLIKELY (info == NULL))
-            break;
-
-          /* skip hidden files if disabled by the user */
-          if (!plugin->hidden_files
-              && g_file_info_get_is_hidden (info))
-            {
-              g_object_unref (G_OBJECT (info));
-              continue;
-            }
-
-          /* if the file is not a directory, check the file patterns */
-          if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY)
-            {
-              if (plugin->patterns == NULL)
-                {
-                  g_object_unref (G_OBJECT (info));
-                  continue;
-                }
-
-              visible = FALSE;
-              display_name = g_file_info_get_display_name (info);
-              if (G_LIKELY (display_name != NULL))
-                for (li = plugin->patterns; !visible && li != NULL; li = li->next)
-                   if (g_pattern_match_string (li->data, display_name))
-                     visible = TRUE;
-
-              if (!visible)
-                {
-                  g_object_unref (G_OBJECT (info));
-                  continue;
-                }
-            }
-
-          infos = g_slist_insert_sorted (infos, info, directory_menu_plugin_menu_sort);
-        }
-
-      g_object_unref (G_OBJECT (iter));
-
-      if (G_LIKELY (infos != NULL))
+      if (G_LIKELY (listing->infos->len > 0))
         {
           mi = gtk_separator_menu_item_new ();
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
           gtk_widget_show (mi);
         }
 
-      for (li = infos; li != NULL; li = li->next)
+      for (i = 0; i < listing->infos->len; i++)
         {
-          info = G_FILE_INFO (li->data);
-          file_type = g_file_info_get_file_type (info);
-
-          display_name = g_file_info_get_display_name (info);
-          if (G_UNLIKELY (display_name == NULL))
-            {
-              g_object_unref (G_OBJECT (info));
-              continue;
-            }
-
-          file = g_file_get_child (dir, g_file_info_get_name (info));
-          icon = NULL;
-
-#ifdef HAVE_GIO_UNIX
-          /* for native desktop files we make an exception and try
-           * to load them like a normal menu */
-          desktopinfo = NULL;
-          if (G_UNLIKELY (file_type != G_FILE_TYPE_DIRECTORY
-              && g_file_is_native (file)
-              && g_str_has_suffix (display_name, ".desktop")))
-            {
-              path = g_file_get_path (file);
-              desktopinfo = g_desktop_app_info_new_from_filename (path);
-              g_free (path);
-
-              if (G_LIKELY (desktopinfo != NULL))
-                {
-                  display_name = g_app_info_get_name (G_APP_INFO (desktopinfo));
-                  icon = g_app_info_get_icon (G_APP_INFO (desktopinfo));
-
-                  /* ignore invalid or hidden files */
-                  if (exo_str_is_empty (display_name)
-                      || g_desktop_app_info_get_is_hidden (desktopinfo))
-                    {
-                      g_object_unref (G_OBJECT (desktopinfo));
-                      g_object_unref (G_OBJECT (info));
-                      g_object_unref (G_OBJECT (file));
-                      continue;
-                    }
-                }
-            }
-#endif
-
-          mi = gtk_image_menu_item_new_with_label (display_name);
+          mi = directory_menu_plugin_menu_item_new (plugin, dir,
+              g_ptr_array_index (listing->infos, i));
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
-          gtk_widget_show (mi);
-
-          if (G_LIKELY (icon == NULL))
-            icon = g_file_info_get_icon (info);
-          if (G_LIKELY (icon != NULL))
-            {
-              image = gtk_image_new_from_gicon (icon, menu_icon_size);
-              gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
-              gtk_widget_show (image);
-            }
-
-          /* set a submenu for directories */
-          if (G_LIKELY (file_type == G_FILE_TYPE_DIRECTORY))
-            {
-              submenu = gtk_menu_new ();
-              gtk_menu_item_set_submenu (GTK_MENU_ITEM (mi), submenu);
-              g_object_set_qdata_full (G_OBJECT (submenu), menu_file, file, g_object_unref);
-
-              g_signal_connect (G_OBJECT (submenu), "show",
-                  G_CALLBACK (directory_menu_plugin_menu_load), plugin);
-              g_signal_connect_after (G_OBJECT (submenu), "hide",
-                  G_CALLBACK (directory_menu_plugin_menu_unload), NULL);
-            }
-#ifdef HAVE_GIO_UNIX
-          else if (G_UNLIKELY (desktopinfo != NULL))
-            {
-              description = g_app_info_get_description (G_APP_INFO (desktopinfo));
-              if (!exo_str_is_empty (description))
-                gtk_widget_set_tooltip_text (mi, description);
-
-              g_signal_connect_data (G_OBJECT (mi), "activate",
-                  G_CALLBACK (directory_menu_plugin_menu_launch_desktop_file),
-                  desktopinfo, (GClosureNotify) g_object_unref, 0);
-
-              g_object_unref (G_OBJECT (file));
-            }
-#endif
-          else
-            {
-              g_signal_connect_data (G_OBJECT (mi), "activate",
-                  G_CALLBACK (directory_menu_plugin_menu_launch), file,
-                  (GClosureNotify) g_object_unref, 0);
-            }
-
-          g_object_unref (G_OBJECT (info));
         }
 
-      g_slist_free (infos);
+      return;
     }
+
+  /* enumerate the directory in the background, the files are added to
+   * the menu in batches, so large or slow directories don't block
+   * the panel */
+  load = g_slice_new0 (DirectoryMenuLoad);
+  load->plugin = g_object_ref (G_OBJECT (plugin));
+  load->menu = g_object_ref (G_OBJECT (menu));
+  load->dir = g_object_ref (G_OBJECT (dir));
+  load->cancellable = g_cancellable_new ();
+  load->infos = g_ptr_array_new ();
+  load->n_header = 2;
+
+  /* directories we can't monitor are not cached */
+  load->monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (G_LIKELY (load->monitor != NULL))
+    g_signal_connect (G_OBJECT (load->monitor), "changed",
+        G_CALLBACK (directory_menu_plugin_menu_load_changed), load);
+
+  /* the load is cancelled when the menu is hidden or destroyed */
+  g_object_set_qdata_full (G_OBJECT (menu), menu_load,
+                           g_object_ref (G_OBJECT (load->cancellable)),
+                           directory_menu_plugin_menu_load_cancel);
+
+  g_file_enumerate_children_async (dir, ENUMERATE_ATTRIBUTES,
+                                   G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+                                   load->cancellable,
+                                   directory_menu_plugin_menu_load_enumerate, load);
 }
 
 
@@ -43,10 +43,13 @@
 #define TOOLTIP_ICON_SIZE              (32)
 #define MENU_ICON_SIZE                 (32)
 #define MENU_POPUP_DELAY               (225)
+#define FILE_CHANGED_DELAY             (250)
 #define NO_ARROW_INSIDE_BUTTON(plugin) ((plugin)->arrow_position != LAUNCHER_ARROW_INTERNAL \
                                         || LIST_HAS_ONE_OR_NO_ENTRIES ((plugin)->items))
 #define ARROW_INSIDE_BUTTON(plugin)    (!NO_ARROW_INSIDE_BUTTON (plugin))
 #define RELATIVE_CONFIG_PATH           PANEL_PLUGIN_RELATIVE_PATH G_DIR_SEPARATOR_S "%s-%d"
+#define DESKTOP_ID_CACHE_FILE          "xfce4" G_DIR_SEPARATOR_S "panel" G_DIR_SEPARATOR_S "launcher-desktop-ids"
+#define DESKTOP_ID_CACHE_HEADER        "# xfce4-panel launcher desktop-id index 1"
 
 
 
@@ -91,7 +94,10 @@ static void               launcher_plugin_menu_item_drag_data_received  (GtkWidg
                                                                          guint                 info,
                                                                          guint                 drag_time,
                                                                          GarconMenuItem       *item);
+static void               launcher_plugin_menu_item_update              (LauncherPlugin       *plugin,
+                                                                         GarconMenuItem       *item);
 static void               launcher_plugin_menu_construct                (LauncherPlugin       *plugin);
+static void               launcher_plugin_menu_prepare                  (LauncherPlugin       *plugin);
 static void               launcher_plugin_menu_popup_destroyed          (gpointer              user_data);
 static gboolean           launcher_plugin_menu_popup                    (gpointer              user_data);
 static void               launcher_plugin_menu_destroy                  (LauncherPlugin       *plugin);
@@ -169,14 +175,18 @@ static void               launcher_plugin_item_exec                     (GarconM
 static void               launcher_plugin_item_exec_from_clipboard      (GarconMenuItem       *item,
                                                                          guint32               event_time,
                                                                          GdkScreen            *screen);
-static void               launcher_plugin_exec_append_quoted            (GString              *string,
-                                                                         const gchar          *unquoted);
 static gboolean           launcher_plugin_exec_parse                    (GarconMenuItem       *item,
                                                                          GSList               *uri_list,
                                                                          gchar              ***argv,
                                                                          GError              **error);
+static gboolean           launcher_plugin_exec_build                    (GarconMenuItem       *item,
+                                                                         GSList               *uri_list,
+                                                                         gchar              ***argv,
+                                                                         GSpawnFlags          *flags,
+                                                                         GError              **error);
 static GSList            *launcher_plugin_uri_list_extract              (GtkSelectionData     *data);
 static void               launcher_plugin_uri_list_free                 (GSList               *uri_list);
+static gchar             *launcher_plugin_desktop_id_lookup             (const gchar          *desktop_id);
 
 
 
@@ -197,11 +207,13 @@ struct _LauncherPlugin
 
   GSList            *items;
 
-  GdkPixbuf         *tooltip_cache;
+  /* item uri -> GarconMenuItem, for fast lookups in the items list */
+  GHashTable        *items_index;
 
   gulong             theme_change_id;
 
   guint              menu_timeout_id;
+  guint              menu_idle_id;
 
   guint              disable_tooltips : 1;
   guint              move_first : 1;
@@ -211,9 +223,38 @@ struct _LauncherPlugin
   GFile             *config_directory;
   GFileMonitor      *config_monitor;
 
+  /* uri -> GFile of the changed files in the config directory */
+  GHashTable        *changed_files;
+  guint              changed_timeout_id;
+
   guint              save_timeout_id;
 };
 
+typedef struct
+{
+  /* command of the item split in arguments, the field codes
+   * that depend on the uri list are expanded on execution */
+  gchar  **argv;
+  gchar   *codes;
+
+  /* absolute path of argv[0] and the PATH used to find it */
+  gchar   *program;
+  gchar   *path_env;
+}
+LauncherExecCache;
+
+typedef struct
+{
+  /* tooltip markup, NULL if the item has no name */
+  gchar     *markup;
+
+  /* icon, loaded on the first query */
+  GdkPixbuf *pixbuf;
+  GdkScreen *screen;
+  guint      pixbuf_loaded : 1;
+}
+LauncherTooltipCache;
+
 enum
 {
   PROP_0,
@@ -236,12 +277,20 @@ XFCE_PANEL_DEFINE_PLUGIN_RESIDENT (LauncherPlugin, launcher_plugin)
 
 
 
-/* quark to attach the plugin to menu items */
+/* quarks to attach the plugin and garcon item to menu items */
 static GQuark      launcher_plugin_quark = 0;
+static GQuark      launcher_plugin_item_quark = 0;
+static GQuark      launcher_plugin_exec_quark = 0;
+static GQuark      launcher_plugin_tooltip_quark = 0;
 static guint       launcher_signals[LAST_SIGNAL];
 static GtkIconSize launcher_menu_icon_size = GTK_ICON_SIZE_INVALID;
 static GtkIconSize launcher_tooltip_icon_size = GTK_ICON_SIZE_INVALID;
 
+/* desktop-id index shared by all launchers in the process */
+static GHashTable *launcher_desktop_ids = NULL;
+static GHashTable *launcher_desktop_id_dirs = NULL;
+static GSList     *launcher_desktop_id_monitors = NULL;
+
 
 
 /* target types for dropping in the launcher plugin */
@@ -320,8 +369,11 @@ launcher_plugin_class_init (LauncherPluginClass *klass)
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
 
-  /* initialize the quark */
+  /* initialize the quarks */
   launcher_plugin_quark = g_quark_from_static_string ("xfce-launcher-plugin");
+  launcher_plugin_item_quark = g_quark_from_static_string ("xfce-launcher-item");
+  launcher_plugin_exec_quark = g_quark_from_static_string ("xfce-launcher-exec");
+  launcher_plugin_tooltip_quark = g_quark_from_static_string ("xfce-launcher-tooltip");
 
   launcher_menu_icon_size = gtk_icon_size_from_name ("panel-launcher-menu");
   if (launcher_menu_icon_size == GTK_ICON_SIZE_INVALID)
@@ -350,9 +402,13 @@ launcher_plugin_init (LauncherPlugin *plugin)
   plugin->menu = NULL;
   plugin->items = NULL;
   plugin->child = NULL;
-  plugin->tooltip_cache = NULL;
   plugin->menu_timeout_id = 0;
+  plugin->menu_idle_id = 0;
   plugin->save_timeout_id = 0;
+  plugin->changed_timeout_id = 0;
+  plugin->items_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  plugin->changed_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, g_object_unref);
 
   /* monitor the default icon theme for changes */
   icon_theme = gtk_icon_theme_get_default ();
@@ -484,15 +540,18 @@ launcher_plugin_item_changed (GarconMenuItem *item,
   panel_return_if_fail (GARCON_IS_MENU_ITEM (item));
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
 
+  /* drop the prepared command and tooltip */
+  g_object_set_qdata (G_OBJECT (item), launcher_plugin_exec_quark, NULL);
+  g_object_set_qdata (G_OBJECT (item), launcher_plugin_tooltip_quark, NULL);
+
   /* find the item */
   li = g_slist_find (plugin->items, item);
   if (G_LIKELY (li != NULL))
     {
-      /* update the button or destroy the menu */
+      /* update the button and patch the item in the menu */
       if (plugin->items == li)
         launcher_plugin_button_update (plugin);
-      else
-        launcher_plugin_menu_destroy (plugin);
+      launcher_plugin_menu_item_update (plugin, item);
     }
   else
     {
@@ -560,8 +619,8 @@ launcher_plugin_item_load (LauncherPlugin *plugin,
 {
   GFile          *src_file, *dst_file;
   gchar          *src_path, *dst_path;
-  GSList         *li, *lnext;
-  GarconMenuItem *item = NULL;
+  gchar          *uri;
+  GarconMenuItem *item;
   GError         *error = NULL;
 
   panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), NULL);
@@ -633,17 +692,14 @@ launcher_plugin_item_load (LauncherPlugin *plugin,
 
   /* maybe we have this file in the launcher configuration, then we don't
    * have to load it again from the harddisk */
-  for (li = plugin->items; item == NULL && li != NULL; li = lnext)
+  uri = g_file_get_uri (src_file);
+  item = g_hash_table_lookup (plugin->items_index, uri);
+  if (item != NULL)
     {
-      lnext = li->next;
-      dst_file = garcon_menu_item_get_file (GARCON_MENU_ITEM (li->data));
-      if (g_file_equal (src_file, dst_file))
-        {
-          item = GARCON_MENU_ITEM (li->data);
-          plugin->items = g_slist_delete_link (plugin->items, li);
-        }
-      g_object_unref (G_OBJECT (dst_file));
+      plugin->items = g_slist_remove (plugin->items, item);
+      g_hash_table_remove (plugin->items_index, uri);
     }
+  g_free (uri);
 
   /* load the file from the disk */
   if (item == NULL)
@@ -695,6 +751,21 @@ launcher_plugin_items_free (LauncherPlugin *plugin)
       g_slist_free (plugin->items);
       plugin->items = NULL;
     }
+
+  g_hash_table_remove_all (plugin->items_index);
+}
+
+
+
+static void
+launcher_plugin_items_index_add (LauncherPlugin *plugin,
+                                 GarconMenuItem *item)
+{
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_IS_MENU_ITEM (item));
+
+  g_hash_table_insert (plugin->items_index,
+                       garcon_menu_item_get_uri (item), item);
 }
 
 
@@ -707,11 +778,10 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
   const GValue   *value;
   const gchar    *str;
   GarconMenuItem *item;
-  GarconMenuItem *pool_item;
   GSList         *items = NULL;
-  GHashTable     *pool = NULL;
+  GSList         *li;
   gboolean        desktop_id;
-  gchar          *uri;
+  gchar          *filename;
   gboolean        items_modified = FALSE;
   gboolean        location_changed;
 
@@ -744,23 +814,19 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
            * try this again in the future */
           items_modified = TRUE;
 
-          /* load the pool with desktop items */
-          if (pool == NULL)
-            pool = launcher_plugin_garcon_menu_pool ();
-
-          /* lookup the item in the item pool */
-          pool_item = g_hash_table_lookup (pool, str);
-          if (pool_item != NULL)
+          /* lookup the desktop file in the shared desktop-id index */
+          filename = launcher_plugin_desktop_id_lookup (str);
+          if (filename != NULL)
             {
               /* we want an editable file, so try to make a copy */
-              uri = garcon_menu_item_get_uri (pool_item);
-              item = launcher_plugin_item_load (plugin, uri, NULL, NULL);
-              g_free (uri);
+              item = launcher_plugin_item_load (plugin, filename, NULL, NULL);
 
-              /* if something failed, use the pool item, but this one
+              /* if something failed, use the global file, but this one
                * won't be editable in the dialog */
               if (G_UNLIKELY (item == NULL))
-                item = g_object_ref (G_OBJECT (pool_item));
+                item = garcon_menu_item_new_for_path (filename);
+
+              g_free (filename);
             }
 
           /* skip this item if still not found */
@@ -779,9 +845,6 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
           G_CALLBACK (launcher_plugin_item_changed), plugin);
     }
 
-  if (G_UNLIKELY (pool != NULL))
-    g_hash_table_destroy (pool);
-
   /* remove config files of items not in the new config */
   launcher_plugin_items_delete_configs (plugin);
 
@@ -789,6 +852,9 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
   launcher_plugin_items_free (plugin);
   plugin->items = items;
 
+  for (li = items; li != NULL; li = li->next)
+    launcher_plugin_items_index_add (plugin, li->data);
+
   /* store the new item list */
   if (items_modified)
     launcher_plugin_save_delayed (plugin);
@@ -807,8 +873,11 @@ launcher_plugin_set_property (GObject      *object,
 
   panel_return_if_fail (G_IS_FILE (plugin->config_directory));
 
-  /* destroy the menu, all the setting changes need this */
-  launcher_plugin_menu_destroy (plugin);
+  /* destroy the menu if the setting changes the menu contents */
+  if (prop_id == PROP_ITEMS
+      || prop_id == PROP_DISABLE_TOOLTIPS
+      || prop_id == PROP_ARROW_POSITION)
+    launcher_plugin_menu_destroy (plugin);
 
   switch (prop_id)
     {
@@ -886,91 +955,82 @@ update_arrow:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
     }
+
+  /* rebuild the menu in the background */
+  launcher_plugin_menu_prepare (plugin);
 }
 
 
 
 static void
-launcher_plugin_file_changed (GFileMonitor      *monitor,
-                              GFile             *changed_file,
-                              GFile             *other_file,
-                              GFileMonitorEvent  event_type,
-                              LauncherPlugin    *plugin)
+launcher_plugin_file_changed_timeout_destroyed (gpointer user_data)
+{
+  XFCE_LAUNCHER_PLUGIN (user_data)->changed_timeout_id = 0;
+}
+
+
+
+static gboolean
+launcher_plugin_file_changed_timeout (gpointer user_data)
 {
-  GSList         *li, *lnext;
+  LauncherPlugin *plugin = XFCE_LAUNCHER_PLUGIN (user_data);
+  GHashTableIter  iter;
+  gpointer        uri, file;
   GarconMenuItem *item;
-  GFile          *item_file;
-  gboolean        found;
   GError         *error = NULL;
-  gchar          *base_name;
-  gboolean        result;
-  gboolean        exists;
   gboolean        update_plugin = FALSE;
 
-  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
-  panel_return_if_fail (plugin->config_monitor == monitor);
-
-  /* waited until all events are proccessed */
-  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
-      && event_type != G_FILE_MONITOR_EVENT_DELETED
-      && event_type != G_FILE_MONITOR_EVENT_CREATED)
-    return;
-
-  /* we only act on desktop files */
-  base_name = g_file_get_basename (changed_file);
-  result = g_str_has_suffix (base_name, ".desktop");
-  g_free (base_name);
-  if (!result)
-    return;
+  panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), FALSE);
 
-  exists = g_file_query_exists (changed_file, NULL);
+  GDK_THREADS_ENTER ();
 
-  /* lookup the file in the menu items */
-  for (li = plugin->items, found = FALSE; !found && li != NULL; li = lnext)
+  g_hash_table_iter_init (&iter, plugin->changed_files);
+  while (g_hash_table_iter_next (&iter, &uri, &file))
     {
-      lnext = li->next;
-      item = GARCON_MENU_ITEM (li->data);
-      item_file = garcon_menu_item_get_file (item);
-      found = g_file_equal (changed_file, item_file);
-      if (found)
+      item = g_hash_table_lookup (plugin->items_index, uri);
+      if (g_file_query_exists (G_FILE (file), NULL))
         {
-          if (exists)
+          if (item != NULL)
             {
-              /* reload the file */
+              /* reload the file, the changed signal patches the button
+               * or the menu item */
               if (!garcon_menu_item_reload (item, NULL, &error))
                 {
                   g_critical ("Failed to reload menu item: %s", error->message);
-                  g_error_free (error);
+                  g_clear_error (&error);
                 }
             }
           else
             {
-              /* remove from the list */
-              plugin->items = g_slist_delete_link (plugin->items, li);
-              g_object_unref (G_OBJECT (item));
-              update_plugin = TRUE;
+              /* add the new file to the config */
+              item = garcon_menu_item_new (G_FILE (file));
+              if (G_LIKELY (item != NULL))
+                {
+                  plugin->items = g_slist_append (plugin->items, item);
+                  launcher_plugin_items_index_add (plugin, item);
+                  g_signal_connect (G_OBJECT (item), "changed",
+                      G_CALLBACK (launcher_plugin_item_changed), plugin);
+                  update_plugin = TRUE;
+                }
             }
         }
-      g_object_unref (G_OBJECT (item_file));
-    }
-
-  if (!found && exists)
-    {
-      /* add the new file to the config */
-      item = garcon_menu_item_new (changed_file);
-      if (G_LIKELY (item != NULL))
+      else if (item != NULL)
         {
-          plugin->items = g_slist_append (plugin->items, item);
-          g_signal_connect (G_OBJECT (item), "changed",
-              G_CALLBACK (launcher_plugin_item_changed), plugin);
+          /* remove from the list */
+          plugin->items = g_slist_remove (plugin->items, item);
+          g_hash_table_remove (plugin->items_index, uri);
+          g_object_unref (G_OBJECT (item));
           update_plugin = TRUE;
         }
     }
 
+  g_hash_table_remove_all (plugin->changed_files);
+
   if (update_plugin)
     {
       launcher_plugin_button_update (plugin);
       launcher_plugin_menu_destroy (plugin);
+      launcher_plugin_menu_prepare (plugin);
 
       /* save the new config */
       launcher_plugin_save_delayed (plugin);
@@ -978,6 +1038,51 @@ launcher_plugin_file_changed (GFileMonitor      *monitor,
       /* update the dialog */
       g_signal_emit (G_OBJECT (plugin), launcher_signals[ITEMS_CHANGED], 0);
     }
+
+  GDK_THREADS_LEAVE ();
+
+  return FALSE;
+}
+
+
+
+static void
+launcher_plugin_file_changed (GFileMonitor      *monitor,
+                              GFile             *changed_file,
+                              GFile             *other_file,
+                              GFileMonitorEvent  event_type,
+                              LauncherPlugin    *plugin)
+{
+  gchar    *base_name;
+  gboolean  result;
+
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+  panel_return_if_fail (plugin->config_monitor == monitor);
+
+  /* waited until all events are proccessed */
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+      && event_type != G_FILE_MONITOR_EVENT_DELETED
+      && event_type != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  /* we only act on desktop files */
+  base_name = g_file_get_basename (changed_file);
+  result = g_str_has_suffix (base_name, ".desktop");
+  g_free (base_name);
+  if (!result)
+    return;
+
+  /* queue the file, multiple events for the same file are merged */
+  g_hash_table_replace (plugin->changed_files, g_file_get_uri (changed_file),
+                        g_object_ref (G_OBJECT (changed_file)));
+
+  /* handle the changes when the burst of events is over, the timeout is
+   * not restarted so a continuous stream of events is still handled */
+  if (plugin->changed_timeout_id == 0)
+    plugin->changed_timeout_id =
+        g_timeout_add_full (G_PRIORITY_LOW, FILE_CHANGED_DELAY,
+                            launcher_plugin_file_changed_timeout, plugin,
+                            launcher_plugin_file_changed_timeout_destroyed);
 }
 
 
@@ -1085,16 +1190,24 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
       g_object_unref (G_OBJECT (plugin->config_monitor));
     }
 
+  /* drop pending file changes */
+  if (plugin->changed_timeout_id != 0)
+    g_source_remove (plugin->changed_timeout_id);
+  g_hash_table_destroy (plugin->changed_files);
+
   if (plugin->save_timeout_id != 0)
     {
       g_source_remove (plugin->save_timeout_id);
       launcher_plugin_save_delayed_timeout (plugin);
     }
 
-  /* destroy the menu and timeout */
+  /* destroy the menu and timeouts */
+  if (plugin->menu_idle_id != 0)
+    g_source_remove (plugin->menu_idle_id);
   launcher_plugin_menu_destroy (plugin);
 
   launcher_plugin_items_free (plugin);
+  g_hash_table_destroy (plugin->items_index);
 
   if (plugin->config_directory != NULL)
     g_object_unref (G_OBJECT (plugin->config_directory));
@@ -1105,10 +1218,6 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
       icon_theme = gtk_icon_theme_get_default ();
       g_signal_handler_disconnect (G_OBJECT (icon_theme), plugin->theme_change_id);
     }
-
-  /* release the cached tooltip */
-  if (plugin->tooltip_cache != NULL)
-    g_object_unref (G_OBJECT (plugin->tooltip_cache));
 }
 
 
@@ -1312,13 +1421,19 @@ launcher_plugin_screen_position_changed (XfcePanelPlugin    *panel_plugin,
                                          XfceScreenPosition  position)
 {
   LauncherPlugin *plugin = XFCE_LAUNCHER_PLUGIN (panel_plugin);
+  GtkArrowType    arrow_type;
+
+  /* leave when the arrow direction did not change */
+  arrow_type = xfce_panel_plugin_arrow_type (panel_plugin);
+  if (xfce_arrow_button_get_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow)) == arrow_type)
+    return;
 
   /* set the new arrow direction */
-  xfce_arrow_button_set_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow),
-      xfce_panel_plugin_arrow_type (panel_plugin));
+  xfce_arrow_button_set_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow), arrow_type);
 
   /* destroy the menu to update sort order */
   launcher_plugin_menu_destroy (plugin);
+  launcher_plugin_menu_prepare (plugin);
 }
 
 
@@ -1327,14 +1442,23 @@ static void
 launcher_plugin_icon_theme_changed (GtkIconTheme   *icon_theme,
                                     LauncherPlugin *plugin)
 {
+  GSList               *li;
+  LauncherTooltipCache *cache;
+
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
   panel_return_if_fail (GTK_IS_ICON_THEME (icon_theme));
 
-  /* invalid the icon cache */
-  if (plugin->tooltip_cache != NULL)
+  /* invalidate the tooltip icons of the items */
+  for (li = plugin->items; li != NULL; li = li->next)
     {
-      g_object_unref (G_OBJECT (plugin->tooltip_cache));
-      plugin->tooltip_cache = NULL;
+      cache = g_object_get_qdata (G_OBJECT (li->data), launcher_plugin_tooltip_quark);
+      if (cache != NULL && cache->pixbuf_loaded)
+        {
+          if (cache->pixbuf != NULL)
+            g_object_unref (G_OBJECT (cache->pixbuf));
+          cache->pixbuf = NULL;
+          cache->pixbuf_loaded = FALSE;
+        }
     }
 }
 
@@ -1479,6 +1603,7 @@ launcher_plugin_menu_item_activate (GtkMenuItem      *widget,
 
       /* destroy the menu and update the icon */
       launcher_plugin_menu_destroy (plugin);
+      launcher_plugin_menu_prepare (plugin);
       launcher_plugin_button_update (plugin);
     }
 }
@@ -1530,16 +1655,87 @@ launcher_plugin_menu_item_drag_data_received (GtkWidget          *widget,
 
 
 
+static void
+launcher_plugin_menu_item_set_item (GtkWidget      *mi,
+                                    GarconMenuItem *item)
+{
+  const gchar *name, *icon_name;
+  GtkWidget   *image;
+  gint         w, h, size;
+
+  panel_return_if_fail (GTK_IS_IMAGE_MENU_ITEM (mi));
+  panel_return_if_fail (GARCON_IS_MENU_ITEM (item));
+
+  name = garcon_menu_item_get_name (item);
+  gtk_menu_item_set_label (GTK_MENU_ITEM (mi),
+      exo_str_is_empty (name) ? _("Unnamed Item") : name);
+
+  /* set the icon if one is set */
+  icon_name = garcon_menu_item_get_icon_name (item);
+  image = gtk_image_menu_item_get_image (GTK_IMAGE_MENU_ITEM (mi));
+  if (!exo_str_is_empty (icon_name))
+    {
+      if (image == NULL)
+        {
+          /* size of the menu items */
+          if (gtk_icon_size_lookup (launcher_menu_icon_size, &w, &h))
+            size = MIN (w, h);
+          else
+            size = MENU_ICON_SIZE;
+
+          image = xfce_panel_image_new_from_source (icon_name);
+          xfce_panel_image_set_size (XFCE_PANEL_IMAGE (image), size);
+          gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
+          gtk_widget_show (image);
+        }
+      else
+        {
+          xfce_panel_image_set_from_source (XFCE_PANEL_IMAGE (image), icon_name);
+        }
+    }
+  else if (image != NULL)
+    {
+      gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), NULL);
+    }
+}
+
+
+
+static void
+launcher_plugin_menu_item_update (LauncherPlugin *plugin,
+                                  GarconMenuItem *item)
+{
+  GList *children, *li;
+
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+  panel_return_if_fail (GARCON_IS_MENU_ITEM (item));
+
+  if (plugin->menu == NULL)
+    return;
+
+  /* patch the menu item of this garcon item */
+  children = gtk_container_get_children (GTK_CONTAINER (plugin->menu));
+  for (li = children; li != NULL; li = li->next)
+    {
+      if (g_object_get_qdata (G_OBJECT (li->data), launcher_plugin_item_quark) == item)
+        {
+          launcher_plugin_menu_item_set_item (GTK_WIDGET (li->data), item);
+          break;
+        }
+    }
+  g_list_free (children);
+}
+
+
+
 static void
 launcher_plugin_menu_construct (LauncherPlugin *plugin)
 {
   GtkArrowType    arrow_type;
   guint           n;
   GarconMenuItem *item;
-  GtkWidget      *mi, *image;
-  const gchar    *name, *icon_name;
+  GtkWidget      *mi;
   GSList         *li;
-  gint            w, h, size;
 
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
   panel_return_if_fail (plugin->menu == NULL);
@@ -1553,12 +1749,6 @@ launcher_plugin_menu_construct (LauncherPlugin *plugin)
   /* get the arrow type of the plugin */
   arrow_type = xfce_arrow_button_get_arrow_type (XFCE_ARROW_BUTTON (plugin->arrow));
 
-  /* size of the menu items */
-  if (gtk_icon_size_lookup (launcher_menu_icon_size, &w, &h))
-    size = MIN (w, h);
-  else
-    size = MENU_ICON_SIZE;
-
   /* walk through the menu entries */
   for (li = plugin->items, n = 0; li != NULL; li = li->next, n++)
     {
@@ -1570,10 +1760,10 @@ launcher_plugin_menu_construct (LauncherPlugin *plugin)
       item = GARCON_MENU_ITEM (li->data);
 
       /* create the menu item */
-      name = garcon_menu_item_get_name (item);
-      mi = gtk_image_menu_item_new_with_label (
-          exo_str_is_empty (name) ? _("Unnamed Item") : name);
+      mi = gtk_image_menu_item_new ();
+      launcher_plugin_menu_item_set_item (mi, item);
       g_object_set_qdata (G_OBJECT (mi), launcher_plugin_quark, plugin);
+      g_object_set_qdata (G_OBJECT (mi), launcher_plugin_item_quark, item);
       gtk_widget_show (mi);
       gtk_drag_dest_set (mi, GTK_DEST_DEFAULT_ALL, drop_targets,
                          G_N_ELEMENTS (drop_targets), GDK_ACTION_COPY);
@@ -1597,16 +1787,6 @@ launcher_plugin_menu_construct (LauncherPlugin *plugin)
         gtk_menu_shell_prepend (GTK_MENU_SHELL (plugin->menu), mi);
       else
         gtk_menu_shell_append (GTK_MENU_SHELL (plugin->menu), mi);
-
-      /* set the icon if one is set */
-      icon_name = garcon_menu_item_get_icon_name (item);
-      if (!exo_str_is_empty (icon_name))
-        {
-          image = xfce_panel_image_new_from_source (icon_name);
-          xfce_panel_image_set_size (XFCE_PANEL_IMAGE (image), size);
-          gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
-          gtk_widget_show (image);
-        }
     }
 }
 
@@ -1630,9 +1810,13 @@ launcher_plugin_menu_popup (gpointer user_data)
 
   GDK_THREADS_ENTER ();
 
-  /* construct the menu if needed */
+  /* construct the menu if the idle build did not run yet */
   if (plugin->menu == NULL)
-    launcher_plugin_menu_construct (plugin);
+    {
+      if (plugin->menu_idle_id != 0)
+        g_source_remove (plugin->menu_idle_id);
+      launcher_plugin_menu_construct (plugin);
+    }
 
   /* toggle the arrow button */
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (plugin->arrow), TRUE);
@@ -1668,6 +1852,56 @@ launcher_plugin_menu_popup (gpointer user_data)
 
 
 
+static void
+launcher_plugin_menu_prepare_destroyed (gpointer user_data)
+{
+  XFCE_LAUNCHER_PLUGIN (user_data)->menu_idle_id = 0;
+}
+
+
+
+static gboolean
+launcher_plugin_menu_prepare_idle (gpointer user_data)
+{
+  LauncherPlugin *plugin = XFCE_LAUNCHER_PLUGIN (user_data);
+
+  panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), FALSE);
+
+  GDK_THREADS_ENTER ();
+
+  /* build the menu and its windows, so the first popup is fast */
+  if (plugin->menu == NULL
+      && LIST_HAS_TWO_OR_MORE_ENTRIES (plugin->items))
+    {
+      launcher_plugin_menu_construct (plugin);
+      gtk_widget_realize (plugin->menu);
+    }
+
+  GDK_THREADS_LEAVE ();
+
+  return FALSE;
+}
+
+
+
+static void
+launcher_plugin_menu_prepare (LauncherPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+
+  /* only a launcher with two or more items has a menu */
+  if (plugin->menu != NULL
+      || plugin->menu_idle_id != 0
+      || !LIST_HAS_TWO_OR_MORE_ENTRIES (plugin->items))
+    return;
+
+  plugin->menu_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+      launcher_plugin_menu_prepare_idle, plugin,
+      launcher_plugin_menu_prepare_destroyed);
+}
+
+
+
 static void
 launcher_plugin_menu_destroy (LauncherPlugin *plugin)
 {
@@ -1699,13 +1933,6 @@ launcher_plugin_button_update (LauncherPlugin *plugin)
 
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
 
-  /* invalate the tooltip icon cache */
-  if (plugin->tooltip_cache != NULL)
-    {
-      g_object_unref (G_OBJECT (plugin->tooltip_cache));
-      plugin->tooltip_cache = NULL;
-    }
-
   /* get first item */
   if (G_LIKELY (plugin->items != NULL))
     item = GARCON_MENU_ITEM (plugin->items->data);
@@ -1848,7 +2075,6 @@ launcher_plugin_button_query_tooltip (GtkWidget      *widget,
                                       GtkTooltip     *tooltip,
                                       LauncherPlugin *plugin)
 {
-  gboolean        result;
   GarconMenuItem *item;
 
   panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), FALSE);
@@ -1863,21 +2089,7 @@ launcher_plugin_button_query_tooltip (GtkWidget      *widget,
   /* get the first item */
   item = GARCON_MENU_ITEM (plugin->items->data);
 
-  /* handle the basic tooltip data */
-  result = launcher_plugin_item_query_tooltip (widget, x, y, keyboard_mode, tooltip, item);
-  if (G_LIKELY (result))
-    {
-      /* set the cached icon if not already set */
-      if (G_UNLIKELY (plugin->tooltip_cache == NULL))
-        plugin->tooltip_cache =
-            launcher_plugin_tooltip_pixbuf (gtk_widget_get_screen (widget),
-                                            garcon_menu_item_get_icon_name (item));
-
-      if (G_LIKELY (plugin->tooltip_cache != NULL))
-        gtk_tooltip_set_icon (tooltip, plugin->tooltip_cache);
-    }
-
-  return result;
+  return launcher_plugin_item_query_tooltip (widget, x, y, keyboard_mode, tooltip, item);
 }
 
 
@@ -2214,6 +2426,19 @@ launcher_plugin_arrow_drag_leave (GtkWidget      *widget,
 
 
 
+static void
+launcher_plugin_tooltip_cache_free (gpointer data)
+{
+  LauncherTooltipCache *cache = data;
+
+  g_free (cache->markup);
+  if (cache->pixbuf != NULL)
+    g_object_unref (G_OBJECT (cache->pixbuf));
+  g_slice_free (LauncherTooltipCache, cache);
+}
+
+
+
 static gboolean
 launcher_plugin_item_query_tooltip (GtkWidget      *widget,
                                     gint            x,
@@ -2222,51 +2447,54 @@ launcher_plugin_item_query_tooltip (GtkWidget      *widget,
                                     GtkTooltip     *tooltip,
                                     GarconMenuItem *item)
 {
-  gchar       *markup;
-  const gchar *name, *comment;
-  GdkPixbuf   *pixbuf;
+  LauncherTooltipCache *cache;
+  const gchar          *name, *comment;
+  GdkScreen            *screen;
 
   panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
 
-  /* require atleast an item name */
-  name = garcon_menu_item_get_name (item);
-  if (exo_str_is_empty (name))
-    return FALSE;
-
-  comment = garcon_menu_item_get_comment (item);
-  if (!exo_str_is_empty (comment))
+  /* tooltips are queried on each pointer motion, so the markup and
+   * icon are cached on the item until it or the icon theme changes */
+  cache = g_object_get_qdata (G_OBJECT (item), launcher_plugin_tooltip_quark);
+  if (G_UNLIKELY (cache == NULL))
     {
-      markup = g_markup_printf_escaped ("<b>%s</b>\n%s", name, comment);
-      gtk_tooltip_set_markup (tooltip, markup);
-      g_free (markup);
+      cache = g_slice_new0 (LauncherTooltipCache);
+
+      /* require atleast an item name */
+      name = garcon_menu_item_get_name (item);
+      if (!exo_str_is_empty (name))
+        {
+          comment = garcon_menu_item_get_comment (item);
+          if (!exo_str_is_empty (comment))
+            cache->markup = g_markup_printf_escaped ("<b>%s</b>\n%s", name, comment);
+          else
+            cache->markup = g_markup_escape_text (name, -1);
+        }
+
+      g_object_set_qdata_full (G_OBJECT (item), launcher_plugin_tooltip_quark,
+                               cache, launcher_plugin_tooltip_cache_free);
     }
-  else
+
+  if (cache->markup == NULL)
+    return FALSE;
+
+  gtk_tooltip_set_markup (tooltip, cache->markup);
+
+  /* load the icon for the screen of the widget */
+  screen = gtk_widget_get_screen (widget);
+  if (!cache->pixbuf_loaded || cache->screen != screen)
     {
-      gtk_tooltip_set_text (tooltip, name);
+      if (cache->pixbuf != NULL)
+        g_object_unref (G_OBJECT (cache->pixbuf));
+
+      cache->pixbuf = launcher_plugin_tooltip_pixbuf (screen,
+          garcon_menu_item_get_icon_name (item));
+      cache->screen = screen;
+      cache->pixbuf_loaded = TRUE;
     }
 
-  /* the button uses a custom cache because the button widget is never
-   * destroyed, for menu items we cache the pixbuf by attaching the
-   * data on the menu item widget */
-  if (GTK_IS_MENU_ITEM (widget))
-    {
-      pixbuf = g_object_get_data (G_OBJECT (widget), I_("pixbuf-cache"));
-      if (G_LIKELY (pixbuf != NULL))
-        {
-          gtk_tooltip_set_icon (tooltip, pixbuf);
-        }
-      else
-        {
-          pixbuf = launcher_plugin_tooltip_pixbuf (gtk_widget_get_screen (widget),
-                                                   garcon_menu_item_get_icon_name (item));
-          if (G_LIKELY (pixbuf != NULL))
-            {
-              gtk_tooltip_set_icon (tooltip, pixbuf);
-              g_object_set_data_full (G_OBJECT (widget), I_("pixbuf-cache"), pixbuf,
-                                      (GDestroyNotify) g_object_unref);
-            }
-        }
-     }
+  if (G_LIKELY (cache->pixbuf != NULL))
+    gtk_tooltip_set_icon (tooltip, cache->pixbuf);
 
   return TRUE;
 }
@@ -2279,20 +2507,21 @@ launcher_plugin_item_exec_on_screen (GarconMenuItem *item,
                                      GdkScreen      *screen,
                                      GSList         *uri_list)
 {
-  GError    *error = NULL;
-  gchar    **argv;
-  gboolean   succeed = FALSE;
+  GError      *error = NULL;
+  gchar      **argv;
+  gboolean     succeed = FALSE;
+  GSpawnFlags  flags;
 
   panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
   panel_return_val_if_fail (GDK_IS_SCREEN (screen), FALSE);
 
-  /* parse the execute command */
-  if (launcher_plugin_exec_parse (item, uri_list, &argv, &error))
+  /* get the arguments of the execute command */
+  if (launcher_plugin_exec_build (item, uri_list, &argv, &flags, &error))
     {
       /* launch the command on the screen */
       succeed = xfce_spawn_on_screen (screen,
                                       garcon_menu_item_get_path (item),
-                                      argv, NULL, G_SPAWN_SEARCH_PATH,
+                                      argv, NULL, flags,
                                       garcon_menu_item_supports_startup_notification (item),
                                       event_time,
                                       garcon_menu_item_get_icon_name (item),
@@ -2403,119 +2632,294 @@ launcher_plugin_item_exec_from_clipboard (GarconMenuItem *item,
 
 
 
-static void
-launcher_plugin_exec_append_quoted (GString     *string,
-                                    const gchar *unquoted)
+static gboolean
+launcher_plugin_exec_parse (GarconMenuItem   *item,
+                            GSList           *uri_list,
+                            gchar          ***argv,
+                            GError          **error)
 {
-  gchar *quoted;
+  gboolean  result;
+  gchar    *uri;
+
+  panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
+
+  uri = garcon_menu_item_get_uri (item);
+  result = panel_utils_exec_parse (garcon_menu_item_get_command (item),
+                                   garcon_menu_item_requires_terminal (item),
+                                   garcon_menu_item_get_icon_name (item),
+                                   garcon_menu_item_get_name (item),
+                                   uri, uri_list, argv, error);
+  g_free (uri);
 
-  quoted = g_shell_quote (unquoted);
-  g_string_append (string, quoted);
-  g_free (quoted);
+  return result;
 }
 
 
 
-static gboolean
-launcher_plugin_exec_parse (GarconMenuItem   *item,
-                            GSList           *uri_list,
-                            gchar          ***argv,
-                            GError          **error)
+static void
+launcher_plugin_exec_cache_free (gpointer data)
 {
-  GString     *string;
-  const gchar *p;
-  gboolean     result;
-  GSList      *li;
-  gchar       *filename, *uri;
-  const gchar *command, *tmp;
+  LauncherExecCache *cache = data;
 
-  panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
+  g_strfreev (cache->argv);
+  g_free (cache->codes);
+  g_free (cache->program);
+  g_free (cache->path_env);
+  g_slice_free (LauncherExecCache, cache);
+}
 
-  /* get the command */
-  command = garcon_menu_item_get_command (item);
-  panel_return_val_if_fail (!exo_str_is_empty (command), FALSE);
 
-  /* allocate an empty string */
-  string = g_string_sized_new (100);
+
+static LauncherExecCache *
+launcher_plugin_exec_cache_new (GarconMenuItem *item)
+{
+  LauncherExecCache  *cache;
+  gchar             **tokens;
+  GPtrArray          *argv;
+  GString            *codes;
+  GString            *string;
+  const gchar        *p, *tmp;
+  gchar              *uri;
+  gboolean            fallback = FALSE;
+  guint               i;
+
+  panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), NULL);
+
+  cache = g_slice_new0 (LauncherExecCache);
+
+  /* errors are reported by the fallback in launcher_plugin_exec_parse */
+  if (!g_shell_parse_argv (garcon_menu_item_get_command (item), NULL, &tokens, NULL))
+    return cache;
+
+  argv = g_ptr_array_new ();
+  codes = g_string_new (NULL);
 
   /* prepend terminal command if required */
   if (garcon_menu_item_requires_terminal (item))
-    g_string_append (string, "exo-open --launch TerminalEmulator ");
+    {
+      g_ptr_array_add (argv, g_strdup ("exo-open"));
+      g_ptr_array_add (argv, g_strdup ("--launch"));
+      g_ptr_array_add (argv, g_strdup ("TerminalEmulator"));
+      g_string_append (codes, "   ");
+    }
 
-  for (p = command; *p != '\0'; ++p)
+  for (i = 0; !fallback && tokens[i] != NULL; i++)
     {
-      if (G_UNLIKELY (p[0] == '%' && p[1] != '\0'))
+      p = tokens[i];
+
+      /* field codes that are a complete argument */
+      if (p[0] == '%' && p[1] != '\0' && p[2] == '\0')
         {
-          switch (*++p)
+          if (strchr ("fFuU", p[1]) != NULL)
+            {
+              g_ptr_array_add (argv, g_strdup (p));
+              g_string_append_c (codes, p[1]);
+              continue;
+            }
+          else if (p[1] == 'i')
             {
-            case 'f':
-            case 'F':
-              for (li = uri_list; li != NULL; li = li->next)
-                {
-                  filename = g_filename_from_uri ((const gchar *) li->data,
-                                                  NULL, NULL);
-                  if (G_LIKELY (filename != NULL))
-                    launcher_plugin_exec_append_quoted (string, filename);
-                  g_free (filename);
-
-                  if (*p == 'f')
-                    break;
-                  if (li->next != NULL)
-                    g_string_append_c (string, ' ');
-                }
-              break;
-
-            case 'u':
-            case 'U':
-              for (li = uri_list; li != NULL; li = li->next)
-                {
-                  launcher_plugin_exec_append_quoted (string, (const gchar *)
-                                                      li->data);
-
-                  if (*p == 'u')
-                    break;
-                  if (li->next != NULL)
-                    g_string_append_c (string, ' ');
-                }
-              break;
-
-            case 'i':
               tmp = garcon_menu_item_get_icon_name (item);
               if (!exo_str_is_empty (tmp))
                 {
-                  g_string_append (string, "--icon ");
-                  launcher_plugin_exec_append_quoted (string, tmp);
+                  g_ptr_array_add (argv, g_strdup ("--icon"));
+                  g_ptr_array_add (argv, g_strdup (tmp));
+                  g_string_append (codes, "  ");
                 }
-              break;
+              continue;
+            }
+        }
 
-            case 'c':
-              tmp = garcon_menu_item_get_name (item);
-              if (!exo_str_is_empty (tmp))
-                launcher_plugin_exec_append_quoted (string, tmp);
-              break;
-
-            case 'k':
-              uri = garcon_menu_item_get_uri (item);
-              if (!exo_str_is_empty (uri))
-                launcher_plugin_exec_append_quoted (string, uri);
-              g_free (uri);
-              break;
-
-            case '%':
-              g_string_append_c (string, '%');
-              break;
+      /* expand the other field codes inside the argument */
+      string = g_string_new (NULL);
+      for (; *p != '\0'; ++p)
+        {
+          if (G_UNLIKELY (p[0] == '%' && p[1] != '\0'))
+            {
+              switch (*++p)
+                {
+                case 'f':
+                case 'F':
+                case 'u':
+                case 'U':
+                case 'i':
+                  /* not a separate argument, use the slow path */
+                  fallback = TRUE;
+                  break;
+
+                case 'c':
+                  tmp = garcon_menu_item_get_name (item);
+                  if (!exo_str_is_empty (tmp))
+                    g_string_append (string, tmp);
+                  break;
+
+                case 'k':
+                  uri = garcon_menu_item_get_uri (item);
+                  if (!exo_str_is_empty (uri))
+                    g_string_append (string, uri);
+                  g_free (uri);
+                  break;
+
+                case '%':
+                  g_string_append_c (string, '%');
+                  break;
+                }
+            }
+          else
+            {
+              g_string_append_c (string, *p);
             }
         }
-      else
+
+      /* drop arguments that only contained empty field codes */
+      if (string->len == 0 && *tokens[i] != '\0')
         {
-          g_string_append_c (string, *p);
+          g_string_free (string, TRUE);
+          continue;
         }
+
+      g_ptr_array_add (argv, g_string_free (string, FALSE));
+      g_string_append_c (codes, ' ');
     }
 
-  result = g_shell_parse_argv (string->str, NULL, argv, error);
-  g_string_free (string, TRUE);
+  g_strfreev (tokens);
 
-  return result;
+  /* the program itself can not be a field code */
+  if (fallback || codes->len == 0 || codes->str[0] != ' ')
+    {
+      g_ptr_array_foreach (argv, (GFunc) g_free, NULL);
+      g_ptr_array_free (argv, TRUE);
+      g_string_free (codes, TRUE);
+      return cache;
+    }
+
+  g_ptr_array_add (argv, NULL);
+  cache->argv = (gchar **) g_ptr_array_free (argv, FALSE);
+  cache->codes = g_string_free (codes, FALSE);
+
+  return cache;
+}
+
+
+
+static const gchar *
+launcher_plugin_exec_cache_program (LauncherExecCache *cache)
+{
+  const gchar *path_env;
+
+  panel_return_val_if_fail (cache->argv != NULL, NULL);
+
+  /* only resolve bare names, a (relative) path is looked up in the
+   * working directory of the item when it is spawned */
+  if (strchr (cache->argv[0], G_DIR_SEPARATOR) != NULL)
+    return NULL;
+
+  /* forget the program if PATH changed or it was removed */
+  path_env = g_getenv ("PATH");
+  if (cache->program != NULL
+      && (g_strcmp0 (path_env, cache->path_env) != 0
+          || !g_file_test (cache->program, G_FILE_TEST_IS_EXECUTABLE)))
+    {
+      g_free (cache->program);
+      cache->program = NULL;
+    }
+
+  if (cache->program == NULL)
+    {
+      cache->program = g_find_program_in_path (cache->argv[0]);
+
+      g_free (cache->path_env);
+      cache->path_env = g_strdup (path_env);
+    }
+
+  return cache->program;
+}
+
+
+
+static gboolean
+launcher_plugin_exec_build (GarconMenuItem   *item,
+                            GSList           *uri_list,
+                            gchar          ***argv,
+                            GSpawnFlags      *flags,
+                            GError          **error)
+{
+  LauncherExecCache *cache;
+  GPtrArray         *array;
+  GSList            *li;
+  gchar             *filename;
+  const gchar       *program;
+  guint              i;
+
+  panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
+
+  /* prepare the command once, it is dropped when the item changes */
+  cache = g_object_get_qdata (G_OBJECT (item), launcher_plugin_exec_quark);
+  if (G_UNLIKELY (cache == NULL))
+    {
+      cache = launcher_plugin_exec_cache_new (item);
+      g_object_set_qdata_full (G_OBJECT (item), launcher_plugin_exec_quark,
+                               cache, launcher_plugin_exec_cache_free);
+    }
+
+  /* commands we could not prepare are parsed on each execution */
+  if (G_UNLIKELY (cache->argv == NULL))
+    {
+      *flags = G_SPAWN_SEARCH_PATH;
+      return launcher_plugin_exec_parse (item, uri_list, argv, error);
+    }
+
+  array = g_ptr_array_new ();
+
+  /* spawn the resolved program directly, keeping the original argv[0] */
+  program = launcher_plugin_exec_cache_program (cache);
+  if (G_LIKELY (program != NULL))
+    {
+      g_ptr_array_add (array, g_strdup (program));
+      *flags = G_SPAWN_FILE_AND_ARGV_ZERO;
+    }
+  else
+    {
+      *flags = G_SPAWN_SEARCH_PATH;
+    }
+
+  for (i = 0; cache->argv[i] != NULL; i++)
+    {
+      switch (cache->codes[i])
+        {
+        case 'f':
+        case 'F':
+          for (li = uri_list; li != NULL; li = li->next)
+            {
+              filename = g_filename_from_uri ((const gchar *) li->data, NULL, NULL);
+              if (G_LIKELY (filename != NULL))
+                g_ptr_array_add (array, filename);
+
+              if (cache->codes[i] == 'f')
+                break;
+            }
+          break;
+
+        case 'u':
+        case 'U':
+          for (li = uri_list; li != NULL; li = li->next)
+            {
+              g_ptr_array_add (array, g_strdup (li->data));
+
+              if (cache->codes[i] == 'u')
+                break;
+            }
+          break;
+
+        default:
+          g_ptr_array_add (array, g_strdup (cache->argv[i]));
+          break;
+        }
+    }
+
+  g_ptr_array_add (array, NULL);
+  *argv = (gchar **) g_ptr_array_free (array, FALSE);
+
+  return TRUE;
 }
 
 
@@ -2632,6 +3036,366 @@ launcher_plugin_unique_filename (LauncherPlugin *plugin)
 
 
 
+static guint64
+launcher_plugin_desktop_id_dir_mtime (const gchar *path)
+{
+  GFile     *file;
+  GFileInfo *info;
+  guint64    mtime = 0;
+
+  file = g_file_new_for_path (path);
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (G_LIKELY (info != NULL))
+    {
+      mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+              * G_USEC_PER_SEC
+              + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      g_object_unref (G_OBJECT (info));
+    }
+  g_object_unref (G_OBJECT (file));
+
+  return mtime;
+}
+
+
+
+static gchar **
+launcher_plugin_desktop_id_roots (void)
+{
+  const gchar * const  *data_dirs;
+  gchar               **roots;
+  guint                 i, n;
+
+  /* the applications directories in order of precedence */
+  data_dirs = g_get_system_data_dirs ();
+  n = g_strv_length ((gchar **) data_dirs);
+
+  roots = g_new0 (gchar *, n + 2);
+  roots[0] = g_build_filename (g_get_user_data_dir (), "applications", NULL);
+  for (i = 0; i < n; i++)
+    roots[i + 1] = g_build_filename (data_dirs[i], "applications", NULL);
+
+  return roots;
+}
+
+
+
+static void
+launcher_plugin_desktop_id_scan (const gchar *path,
+                                 const gchar *prefix)
+{
+  GDir        *dir;
+  const gchar *name;
+  gchar       *filename;
+  gchar       *desktop_id;
+  guint64     *mtime;
+
+  /* skip directories that are listed twice in the data dirs */
+  if (g_hash_table_lookup (launcher_desktop_id_dirs, path) != NULL)
+    return;
+
+  /* also store directories that do not exist, so the index is
+   * invalidated when they are created */
+  mtime = g_new (guint64, 1);
+  *mtime = launcher_plugin_desktop_id_dir_mtime (path);
+  g_hash_table_insert (launcher_desktop_id_dirs, g_strdup (path), mtime);
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      /* these would break the cache file and are no valid ids anyway */
+      if (strpbrk (name, "\t\n") != NULL)
+        continue;
+
+      filename = g_build_filename (path, name, NULL);
+
+      if (g_str_has_suffix (name, ".desktop"))
+        {
+          /* the first directory in the data dirs wins */
+          desktop_id = g_strconcat (prefix, name, NULL);
+          if (g_hash_table_lookup (launcher_desktop_ids, desktop_id) == NULL)
+            {
+              g_hash_table_insert (launcher_desktop_ids, desktop_id, filename);
+              filename = NULL;
+            }
+          else
+            {
+              g_free (desktop_id);
+            }
+        }
+      else if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+        {
+          /* files in subdirectories get the directory name as prefix */
+          desktop_id = g_strconcat (prefix, name, "-", NULL);
+          launcher_plugin_desktop_id_scan (filename, desktop_id);
+          g_free (desktop_id);
+        }
+
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+}
+
+
+
+static gboolean
+launcher_plugin_desktop_id_cache_load (gchar **roots)
+{
+  gchar     *filename;
+  gchar     *contents;
+  gchar    **lines;
+  gchar    **fields;
+  guint      i;
+  guint      n_roots = 0;
+  guint64   *mtime;
+  gboolean   valid = FALSE;
+
+  filename = xfce_resource_lookup (XFCE_RESOURCE_CACHE, DESKTOP_ID_CACHE_FILE);
+  if (filename == NULL)
+    return FALSE;
+
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      g_free (filename);
+      return FALSE;
+    }
+  g_free (filename);
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  if (lines[0] == NULL || strcmp (lines[0], DESKTOP_ID_CACHE_HEADER) != 0)
+    goto out;
+
+  for (i = 1; lines[i] != NULL; i++)
+    {
+      if (*lines[i] == '\0')
+        continue;
+
+      fields = g_strsplit (lines[i], "\t", 3);
+      if (g_strv_length (fields) != 3)
+        {
+          g_strfreev (fields);
+          goto out;
+        }
+
+      if (*fields[0] == 'R')
+        {
+          /* the data dirs must be the same and in the same order */
+          if (roots[n_roots] == NULL
+              || strcmp (roots[n_roots], fields[2]) != 0)
+            {
+              g_strfreev (fields);
+              goto out;
+            }
+          n_roots++;
+        }
+      else if (*fields[0] == 'D')
+        {
+          /* the directory should not have been modified since the
+           * index was written */
+          mtime = g_new (guint64, 1);
+          *mtime = g_ascii_strtoull (fields[1], NULL, 10);
+          if (*mtime != launcher_plugin_desktop_id_dir_mtime (fields[2]))
+            {
+              g_free (mtime);
+              g_strfreev (fields);
+              goto out;
+            }
+          g_hash_table_insert (launcher_desktop_id_dirs, g_strdup (fields[2]), mtime);
+        }
+      else if (*fields[0] == 'I')
+        {
+          g_hash_table_insert (launcher_desktop_ids, g_strdup (fields[1]),
+                               g_strdup (fields[2]));
+        }
+
+      g_strfreev (fields);
+    }
+
+  valid = (roots[n_roots] == NULL);
+
+out:
+  g_strfreev (lines);
+
+  if (!valid)
+    {
+      g_hash_table_remove_all (launcher_desktop_ids);
+      g_hash_table_remove_all (launcher_desktop_id_dirs);
+    }
+
+  return valid;
+}
+
+
+
+static void
+launcher_plugin_desktop_id_cache_save (gchar **roots)
+{
+  gchar          *filename;
+  GString        *contents;
+  GHashTableIter  iter;
+  gpointer        key, value;
+  guint           i;
+  GError         *error = NULL;
+
+  filename = xfce_resource_save_location (XFCE_RESOURCE_CACHE,
+                                          DESKTOP_ID_CACHE_FILE, TRUE);
+  if (G_UNLIKELY (filename == NULL))
+    return;
+
+  contents = g_string_new (DESKTOP_ID_CACHE_HEADER "\n");
+
+  for (i = 0; roots[i] != NULL; i++)
+    g_string_append_printf (contents, "R\t0\t%s\n", roots[i]);
+
+  g_hash_table_iter_init (&iter, launcher_desktop_id_dirs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_string_append_printf (contents, "D\t%" G_GUINT64_FORMAT "\t%s\n",
+                            *((guint64 *) value), (const gchar *) key);
+
+  g_hash_table_iter_init (&iter, launcher_desktop_ids);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_string_append_printf (contents, "I\t%s\t%s\n",
+                            (const gchar *) key, (const gchar *) value);
+
+  if (!g_file_set_contents (filename, contents->str, contents->len, &error))
+    {
+      g_warning ("Failed to write the desktop-id index to \"%s\": %s",
+                 filename, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (contents, TRUE);
+  g_free (filename);
+}
+
+
+
+static void
+launcher_plugin_desktop_id_index_clear (void)
+{
+  GSList *li;
+
+  for (li = launcher_desktop_id_monitors; li != NULL; li = li->next)
+    {
+      g_file_monitor_cancel (G_FILE_MONITOR (li->data));
+      g_object_unref (G_OBJECT (li->data));
+    }
+  g_slist_free (launcher_desktop_id_monitors);
+  launcher_desktop_id_monitors = NULL;
+
+  if (launcher_desktop_ids != NULL)
+    {
+      g_hash_table_destroy (launcher_desktop_ids);
+      launcher_desktop_ids = NULL;
+    }
+
+  if (launcher_desktop_id_dirs != NULL)
+    {
+      g_hash_table_destroy (launcher_desktop_id_dirs);
+      launcher_desktop_id_dirs = NULL;
+    }
+}
+
+
+
+static void
+launcher_plugin_desktop_id_dir_changed (GFileMonitor      *monitor,
+                                        GFile             *file,
+                                        GFile             *other_file,
+                                        GFileMonitorEvent  event_type,
+                                        gpointer           user_data)
+{
+  /* only added and removed files change the index */
+  if (event_type != G_FILE_MONITOR_EVENT_CREATED
+      && event_type != G_FILE_MONITOR_EVENT_DELETED
+      && event_type != G_FILE_MONITOR_EVENT_MOVED)
+    return;
+
+  /* drop the index, it is rebuilt on the next lookup */
+  launcher_plugin_desktop_id_index_clear ();
+}
+
+
+
+static void
+launcher_plugin_desktop_id_index_ensure (void)
+{
+  gchar          **roots;
+  guint            i;
+  GHashTableIter   iter;
+  gpointer         key, value;
+  GFile           *file;
+  GFileMonitor    *monitor;
+
+  if (G_LIKELY (launcher_desktop_ids != NULL))
+    return;
+
+  launcher_desktop_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, g_free);
+  launcher_desktop_id_dirs = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    g_free, g_free);
+
+  /* try the index in the cache directory, else scan the directories */
+  roots = launcher_plugin_desktop_id_roots ();
+  if (!launcher_plugin_desktop_id_cache_load (roots))
+    {
+      for (i = 0; roots[i] != NULL; i++)
+        launcher_plugin_desktop_id_scan (roots[i], "");
+
+      launcher_plugin_desktop_id_cache_save (roots);
+    }
+  g_strfreev (roots);
+
+  /* watch the existing directories for added and removed files */
+  g_hash_table_iter_init (&iter, launcher_desktop_id_dirs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (*((guint64 *) value) == 0)
+        continue;
+
+      file = g_file_new_for_path (key);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+      if (G_LIKELY (monitor != NULL))
+        {
+          g_signal_connect (G_OBJECT (monitor), "changed",
+              G_CALLBACK (launcher_plugin_desktop_id_dir_changed), NULL);
+          launcher_desktop_id_monitors =
+              g_slist_prepend (launcher_desktop_id_monitors, monitor);
+        }
+      g_object_unref (G_OBJECT (file));
+    }
+}
+
+
+
+static gchar *
+launcher_plugin_desktop_id_lookup (const gchar *desktop_id)
+{
+  const gchar *filename;
+
+  panel_return_val_if_fail (desktop_id != NULL, NULL);
+
+  launcher_plugin_desktop_id_index_ensure ();
+
+  /* check the file, the monitor event might still be pending */
+  filename = g_hash_table_lookup (launcher_desktop_ids, desktop_id);
+  if (filename != NULL
+      && g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+    return g_strdup (filename);
+
+  return NULL;
+}
+
+
+
 static void
 launcher_plugin_garcon_menu_pool_add (GarconMenu *menu,
                                       GHashTable *pool)
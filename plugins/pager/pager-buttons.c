@@ -68,8 +68,15 @@ struct _PagerButtons
 {
   GtkTable __parent__;
 
+  /* buttons in layout order */
   GSList         *buttons;
 
+  /* workspace to button lookup */
+  GHashTable     *workspace_buttons;
+
+  GtkWidget      *active_button;
+  guint           viewport_mode : 1;
+
   guint           rebuild_id;
 
   WnckScreen     *wnck_screen;
@@ -142,6 +149,9 @@ pager_buttons_init (PagerButtons *pager)
   pager->wnck_screen = NULL;
   pager->orientation = GTK_ORIENTATION_HORIZONTAL;
   pager->buttons = NULL;
+  pager->workspace_buttons = g_hash_table_new (g_direct_hash, g_direct_equal);
+  pager->active_button = NULL;
+  pager->viewport_mode = FALSE;
   pager->rebuild_id = 0;
 
   /* although I'd prefer normal allocation, the homogeneous setting
@@ -243,6 +253,7 @@ pager_buttons_finalize (GObject *object)
     }
 
   g_slist_free (pager->buttons);
+  g_hash_table_destroy (pager->workspace_buttons);
 
   (*G_OBJECT_CLASS (pager_buttons_parent_class)->finalize) (object);
 }
@@ -270,18 +281,128 @@ pager_buttons_button_press_event (GtkWidget      *button,
 
 
 
+static GtkWidget *
+pager_buttons_button_new (PagerButtons *pager)
+{
+  GtkWidget *button;
+  GtkWidget *panel_plugin;
+  GtkWidget *label;
+
+  button = xfce_panel_create_toggle_button ();
+  g_signal_connect (G_OBJECT (button), "button-press-event",
+      G_CALLBACK (pager_buttons_button_press_event), NULL);
+  gtk_widget_show (button);
+
+  panel_plugin = gtk_widget_get_ancestor (GTK_WIDGET (pager), XFCE_TYPE_PANEL_PLUGIN);
+  xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (panel_plugin), button);
+
+  label = gtk_label_new (NULL);
+  gtk_container_add (GTK_CONTAINER (button), label);
+  gtk_widget_show (label);
+
+  return button;
+}
+
+
+
+static void
+pager_buttons_button_remove (PagerButtons *pager,
+                             GtkWidget    *button)
+{
+  WnckWorkspace *workspace;
+
+  panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
+  panel_return_if_fail (GTK_IS_TOGGLE_BUTTON (button));
+
+  workspace = g_object_get_data (G_OBJECT (button), "workspace");
+  if (workspace != NULL)
+    g_hash_table_remove (pager->workspace_buttons, workspace);
+
+  if (pager->active_button == button)
+    pager->active_button = NULL;
+
+  pager->buttons = g_slist_remove (pager->buttons, button);
+  gtk_widget_destroy (button);
+}
+
+
+
+static void
+pager_buttons_button_attach (PagerButtons *pager,
+                             GtkWidget    *button,
+                             gint          n,
+                             gint          cols)
+{
+  gint row, col;
+  gint left_attach, top_attach;
+
+  if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
+    {
+      row = n % cols;
+      col = n / cols;
+    }
+  else
+    {
+      row = n / cols;
+      col = n % cols;
+    }
+
+  /* new button or move the existing one if its cell changed */
+  if (gtk_widget_get_parent (button) == NULL)
+    {
+      gtk_table_attach (GTK_TABLE (pager), button,
+                        row, row + 1, col, col + 1,
+                        GTK_FILL | GTK_EXPAND, GTK_FILL | GTK_EXPAND,
+                        0, 0);
+    }
+  else
+    {
+      gtk_container_child_get (GTK_CONTAINER (pager), button,
+                               "left-attach", &left_attach,
+                               "top-attach", &top_attach, NULL);
+      if (left_attach != row || top_attach != col)
+        gtk_container_child_set (GTK_CONTAINER (pager), button,
+                                 "left-attach", row, "right-attach", row + 1,
+                                 "top-attach", col, "bottom-attach", col + 1, NULL);
+    }
+
+  gtk_label_set_angle (GTK_LABEL (gtk_bin_get_child (GTK_BIN (button))),
+      pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
+}
+
+
+
+static void
+pager_buttons_set_active (PagerButtons *pager,
+                          GtkWidget    *button)
+{
+  panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
+  panel_return_if_fail (button == NULL || GTK_IS_TOGGLE_BUTTON (button));
+
+  if (pager->active_button != NULL
+      && pager->active_button != button)
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (pager->active_button), FALSE);
+
+  pager->active_button = button;
+
+  if (button != NULL)
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
+}
+
+
+
 static gboolean
 pager_buttons_rebuild_idle (gpointer user_data)
 {
   PagerButtons  *pager = XFCE_PAGER_BUTTONS (user_data);
   GList         *li, *workspaces;
+  GSList        *old_buttons;
   WnckWorkspace *active_ws;
   gint           n, n_workspaces;
   gint           rows, cols;
-  gint           row, col;
   GtkWidget     *button;
+  GtkWidget     *active_button = NULL;
   WnckWorkspace *workspace = NULL;
-  GtkWidget     *panel_plugin;
   GtkWidget     *label;
   gint           workspace_width, workspace_height = 0;
   gint           screen_width = 0, screen_height = 0;
@@ -296,16 +417,14 @@ pager_buttons_rebuild_idle (gpointer user_data)
 
   GDK_THREADS_ENTER ();
 
-  gtk_container_foreach (GTK_CONTAINER (pager),
-      (GtkCallback) gtk_widget_destroy, NULL);
-
-  g_slist_free (pager->buttons);
-  pager->buttons = NULL;
-
   active_ws = wnck_screen_get_active_workspace (pager->wnck_screen);
   workspaces = wnck_screen_get_workspaces (pager->wnck_screen);
   if (workspaces == NULL)
-    goto leave;
+    {
+      while (pager->buttons != NULL)
+        pager_buttons_button_remove (pager, pager->buttons->data);
+      goto leave;
+    }
 
   n_workspaces = g_list_length (workspaces);
 
@@ -351,13 +470,17 @@ pager_buttons_rebuild_idle (gpointer user_data)
         cols++;
     }
 
-  if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
-    gtk_table_resize (GTK_TABLE (pager), rows, cols);
-  else
-    gtk_table_resize (GTK_TABLE (pager), cols, rows);
-
+  /* the buttons of the other mode cannot be reused */
+  if (pager->viewport_mode != viewport_mode)
+    {
+      while (pager->buttons != NULL)
+        pager_buttons_button_remove (pager, pager->buttons->data);
+      pager->viewport_mode = viewport_mode;
+    }
 
-  panel_plugin = gtk_widget_get_ancestor (GTK_WIDGET (pager), XFCE_TYPE_PANEL_PLUGIN);
+  /* take the current buttons, the ones not reused are removed below */
+  old_buttons = pager->buttons;
+  pager->buttons = NULL;
 
   if (G_UNLIKELY (viewport_mode))
     {
@@ -368,47 +491,37 @@ pager_buttons_rebuild_idle (gpointer user_data)
 
       for (n = 0; n < n_viewports; n++)
         {
-          vp_info = g_new0 (gint, N_INFOS);
-          vp_info[VIEWPORT_X] = (n % (workspace_height / screen_height)) * screen_width;
-          vp_info[VIEWPORT_Y] = (n / (workspace_height / screen_height)) * screen_height;
-
-          button = xfce_panel_create_toggle_button ();
-          if (viewport_x >= vp_info[VIEWPORT_X] && viewport_x < vp_info[VIEWPORT_X] + screen_width
-              && viewport_y >= vp_info[VIEWPORT_Y] && viewport_y < vp_info[VIEWPORT_Y] + screen_height)
-            gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
-          g_signal_connect (G_OBJECT (button), "toggled",
-              G_CALLBACK (pager_buttons_viewport_button_toggled), pager);
-          g_signal_connect (G_OBJECT (button), "button-press-event",
-              G_CALLBACK (pager_buttons_button_press_event), NULL);
-          xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (panel_plugin), button);
-          gtk_widget_show (button);
-
-          g_object_set_data_full (G_OBJECT (button), "viewport-info", vp_info,
-                                  (GDestroyNotify) g_free);
-
-          g_snprintf (text, sizeof (text), "%d", n + 1);
-          label = gtk_label_new (text);
-          gtk_label_set_angle (GTK_LABEL (label),
-              pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
-          gtk_container_add (GTK_CONTAINER (button), label);
-          gtk_widget_show (label);
-
-          if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
+          /* viewport buttons only differ in their position */
+          if (old_buttons != NULL)
             {
-              row = n % cols;
-              col = n / cols;
+              button = old_buttons->data;
+              old_buttons = g_slist_delete_link (old_buttons, old_buttons);
+              vp_info = g_object_get_data (G_OBJECT (button), "viewport-info");
             }
           else
             {
-              row = n / cols;
-              col = n % cols;
+              button = pager_buttons_button_new (pager);
+              g_signal_connect (G_OBJECT (button), "toggled",
+                  G_CALLBACK (pager_buttons_viewport_button_toggled), pager);
+
+              vp_info = g_new0 (gint, N_INFOS);
+              g_object_set_data_full (G_OBJECT (button), "viewport-info", vp_info,
+                                      (GDestroyNotify) g_free);
+
+              g_snprintf (text, sizeof (text), "%d", n + 1);
+              label = gtk_bin_get_child (GTK_BIN (button));
+              gtk_label_set_text (GTK_LABEL (label), text);
             }
 
+          vp_info[VIEWPORT_X] = (n % (workspace_height / screen_height)) * screen_width;
+          vp_info[VIEWPORT_Y] = (n / (workspace_height / screen_height)) * screen_height;
+
+          if (viewport_x >= vp_info[VIEWPORT_X] && viewport_x < vp_info[VIEWPORT_X] + screen_width
+              && viewport_y >= vp_info[VIEWPORT_Y] && viewport_y < vp_info[VIEWPORT_Y] + screen_height)
+            active_button = button;
 
-          gtk_table_attach (GTK_TABLE (pager), button,
-                            row, row + 1, col, col + 1,
-                            GTK_FILL | GTK_EXPAND, GTK_FILL | GTK_EXPAND,
-                            0, 0);
+          pager_buttons_button_attach (pager, button, n, cols);
+          pager->buttons = g_slist_prepend (pager->buttons, button);
         }
     }
   else
@@ -417,47 +530,54 @@ pager_buttons_rebuild_idle (gpointer user_data)
         {
           workspace = WNCK_WORKSPACE (li->data);
 
-          button = xfce_panel_create_toggle_button ();
-          if (workspace == active_ws)
-            gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
-          g_signal_connect (G_OBJECT (button), "toggled",
-              G_CALLBACK (pager_buttons_workspace_button_toggled), workspace);
-          g_signal_connect (G_OBJECT (button), "button-press-event",
-              G_CALLBACK (pager_buttons_button_press_event), NULL);
-          xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (panel_plugin), button);
-          gtk_widget_show (button);
-
-          label = gtk_label_new (NULL);
-          g_signal_connect_object (G_OBJECT (workspace), "name-changed",
-              G_CALLBACK (pager_buttons_workspace_button_label), label, 0);
-          pager_buttons_workspace_button_label (workspace, label);
-          gtk_label_set_angle (GTK_LABEL (label),
-              pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
-          gtk_container_add (GTK_CONTAINER (button), label);
-          gtk_widget_show (label);
-
-          pager->buttons = g_slist_prepend (pager->buttons, button);
-
-          if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
+          button = g_hash_table_lookup (pager->workspace_buttons, workspace);
+          if (button != NULL)
             {
-              row = n % cols;
-              col = n / cols;
+              old_buttons = g_slist_remove (old_buttons, button);
+
+              /* the default name contains the workspace number */
+              label = gtk_bin_get_child (GTK_BIN (button));
+              pager_buttons_workspace_button_label (workspace, label);
             }
           else
             {
-              row = n / cols;
-              col = n % cols;
+              button = pager_buttons_button_new (pager);
+              g_signal_connect (G_OBJECT (button), "toggled",
+                  G_CALLBACK (pager_buttons_workspace_button_toggled), workspace);
+              g_object_set_data (G_OBJECT (button), "workspace", workspace);
+              g_hash_table_insert (pager->workspace_buttons, workspace, button);
+
+              label = gtk_bin_get_child (GTK_BIN (button));
+              g_signal_connect_object (G_OBJECT (workspace), "name-changed",
+                  G_CALLBACK (pager_buttons_workspace_button_label), label, 0);
+              pager_buttons_workspace_button_label (workspace, label);
             }
 
-          gtk_table_attach (GTK_TABLE (pager), button,
-                            row, row + 1, col, col + 1,
-                            GTK_FILL | GTK_EXPAND, GTK_FILL | GTK_EXPAND,
-                            0, 0);
+          if (workspace == active_ws)
+            active_button = button;
+
+          pager_buttons_button_attach (pager, button, n, cols);
+          pager->buttons = g_slist_prepend (pager->buttons, button);
         }
     }
 
   pager->buttons = g_slist_reverse (pager->buttons);
 
+  /* remove the buttons that are not in the layout anymore */
+  while (old_buttons != NULL)
+    {
+      pager_buttons_button_remove (pager, old_buttons->data);
+      old_buttons = g_slist_delete_link (old_buttons, old_buttons);
+    }
+
+  /* shrink the table after the buttons moved */
+  if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
+    gtk_table_resize (GTK_TABLE (pager), rows, cols);
+  else
+    gtk_table_resize (GTK_TABLE (pager), cols, rows);
+
+  pager_buttons_set_active (pager, active_button);
+
   leave:
 
   GDK_THREADS_LEAVE ();
@@ -494,21 +614,23 @@ pager_buttons_screen_workspace_changed (WnckScreen    *screen,
                                         WnckWorkspace *previous_workspace,
                                         PagerButtons  *pager)
 {
-  gint           active = -1, n;
   WnckWorkspace *active_ws;
-  GSList        *li;
+  GtkWidget     *button = NULL;
 
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (previous_workspace == NULL || WNCK_IS_WORKSPACE (previous_workspace));
   panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
   panel_return_if_fail (pager->wnck_screen == screen);
 
+  /* viewport buttons are toggled when the viewports change */
+  if (pager->viewport_mode)
+    return;
+
   active_ws = wnck_screen_get_active_workspace (screen);
   if (G_LIKELY (active_ws != NULL))
-    active = wnck_workspace_get_number (active_ws);
+    button = g_hash_table_lookup (pager->workspace_buttons, active_ws);
 
-  for (li = pager->buttons, n = 0; li != NULL; li = li->next, n++)
-    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (li->data), n == active);
+  pager_buttons_set_active (pager, button);
 }
 
 
@@ -533,11 +655,18 @@ pager_buttons_screen_workspace_destroyed (WnckScreen    *screen,
                                           WnckWorkspace *destroyed_workspace,
                                           PagerButtons  *pager)
 {
+  GtkWidget *button;
+
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (WNCK_IS_WORKSPACE (destroyed_workspace));
   panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
   panel_return_if_fail (pager->wnck_screen == screen);
 
+  /* remove the button now, so it never points to a dead workspace */
+  button = g_hash_table_lookup (pager->workspace_buttons, destroyed_workspace);
+  if (button != NULL)
+    pager_buttons_button_remove (pager, button);
+
   pager_buttons_queue_rebuild (pager);
 }
 
@@ -552,8 +681,9 @@ pager_buttons_screen_viewports_changed (WnckScreen    *screen,
   panel_return_if_fail (pager->wnck_screen == screen);
 
   /* yes we are extremely lazy here, but this event is
-   * also emitted when the viewport setup changes... */
-  if (pager->buttons == NULL)
+   * also emitted when the viewport setup changes... the
+   * rebuild only updates the existing buttons */
+  if (pager->viewport_mode || pager->buttons == NULL)
     pager_buttons_queue_rebuild (pager);
 }
 
@@ -565,6 +695,7 @@ pager_buttons_workspace_button_label (WnckWorkspace *workspace,
 {
   const gchar *name;
   gchar       *utf8 = NULL, *name_num = NULL;
+  const gchar *text;
 
   panel_return_if_fail (WNCK_IS_WORKSPACE (workspace));
   panel_return_if_fail (GTK_IS_LABEL (label));
@@ -579,7 +710,10 @@ pager_buttons_workspace_button_label (WnckWorkspace *workspace,
     name = name_num = g_strdup_printf (_("Workspace %d"),
         wnck_workspace_get_number (workspace) + 1);
 
-  gtk_label_set_text (GTK_LABEL (label), name);
+  /* avoid a resize if nothing changed */
+  text = gtk_label_get_text (GTK_LABEL (label));
+  if (g_strcmp0 (text, name) != 0)
+    gtk_label_set_text (GTK_LABEL (label), name);
 
   g_free (utf8);
   g_free (name_num);
@@ -616,6 +750,11 @@ pager_buttons_viewport_button_toggled (GtkWidget    *button,
   panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
   panel_return_if_fail (WNCK_IS_SCREEN (pager->wnck_screen));
 
+  /* only move when activated by the user */
+  if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button))
+      || pager->active_button == button)
+    return;
+
   vp_info = g_object_get_data (G_OBJECT (button), "viewport-info");
   if (G_UNLIKELY (vp_info == NULL))
     return;
@@ -285,13 +285,22 @@ pager_plugin_screen_layout_changed (PagerPlugin *plugin)
   panel_return_if_fail (XFCE_IS_PAGER_PLUGIN (plugin));
   panel_return_if_fail (WNCK_IS_SCREEN (plugin->wnck_screen));
 
+  mode = xfce_panel_plugin_get_mode (XFCE_PANEL_PLUGIN (plugin));
+
   if (G_UNLIKELY (plugin->pager != NULL))
     {
+      /* reconfigure the existing pager if the view did not change */
+      if (plugin->miniature_view ?
+          WNCK_IS_PAGER (plugin->pager) : XFCE_IS_PAGER_BUTTONS (plugin->pager))
+        {
+          pager_plugin_mode_changed (XFCE_PANEL_PLUGIN (plugin), mode);
+          gtk_widget_queue_resize (plugin->pager);
+          return;
+        }
+
       gtk_widget_destroy (GTK_WIDGET (plugin->pager));
-      wnck_screen_force_update (plugin->wnck_screen);
     }
 
-  mode = xfce_panel_plugin_get_mode (XFCE_PANEL_PLUGIN (plugin));
   orientation =
     (mode != XFCE_PANEL_PLUGIN_MODE_VERTICAL) ?
     GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL;
@@ -339,8 +348,22 @@ pager_plugin_screen_changed (GtkWidget *widget,
 
   if (plugin->wnck_screen != wnck_screen)
     {
+      if (previous_screen != NULL)
+        g_signal_handlers_disconnect_by_func (G_OBJECT (previous_screen),
+            G_CALLBACK (pager_plugin_screen_layout_changed), plugin);
+
       plugin->wnck_screen = wnck_screen;
 
+      /* the pager is bound to the old screen, only
+       * resync wnck when it's replaced */
+      if (plugin->pager != NULL)
+        {
+          gtk_widget_destroy (GTK_WIDGET (plugin->pager));
+          plugin->pager = NULL;
+
+          wnck_screen_force_update (plugin->wnck_screen);
+        }
+
       pager_plugin_screen_layout_changed (plugin);
 
       g_signal_connect_swapped (G_OBJECT (screen), "monitors-changed",
@@ -395,6 +418,8 @@ pager_plugin_free_data (XfcePanelPlugin *panel_plugin)
 
   g_signal_handlers_disconnect_by_func (G_OBJECT (plugin),
       pager_plugin_screen_changed, NULL);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (gtk_widget_get_screen (GTK_WIDGET (plugin))),
+      G_CALLBACK (pager_plugin_screen_layout_changed), plugin);
 }
 
 
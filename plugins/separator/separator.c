@@ -49,9 +49,14 @@ static void     separator_plugin_set_property              (GObject
                                                             guint                  prop_id,
                                                             const GValue          *value,
                                                             GParamSpec            *pspec);
+static void     separator_plugin_dots_free                 (SeparatorPlugin       *plugin);
 static gboolean separator_plugin_expose_event              (GtkWidget             *widget,
                                                             GdkEventExpose        *event);
+static void     separator_plugin_style_set                 (GtkWidget             *widget,
+                                                            GtkStyle              *previous_style);
+static void     separator_plugin_unrealize                 (GtkWidget             *widget);
 static void     separator_plugin_construct                 (XfcePanelPlugin       *panel_plugin);
+static void     separator_plugin_free_data                 (XfcePanelPlugin       *panel_plugin);
 static gboolean separator_plugin_size_changed              (XfcePanelPlugin       *panel_plugin,
                                                             gint                   size);
 static void     separator_plugin_configure_plugin          (XfcePanelPlugin       *panel_plugin);
@@ -87,6 +92,14 @@ struct _SeparatorPlugin
 
   /* separator style */
   SeparatorPluginStyle  style;
+
+  /* cached dots pattern */
+  GdkPixmap            *dots_pixmap;
+  GdkBitmap            *dots_mask;
+  GdkGC                *dots_gc;
+  gint                  dots_width;
+  gint                  dots_height;
+  GtkStateType          dots_state;
 };
 
 enum
@@ -125,9 +138,12 @@ separator_plugin_class_init (SeparatorPluginClass *klass)
 
   widget_class = GTK_WIDGET_CLASS (klass);
   widget_class->expose_event = separator_plugin_expose_event;
+  widget_class->style_set = separator_plugin_style_set;
+  widget_class->unrealize = separator_plugin_unrealize;
 
   plugin_class = XFCE_PANEL_PLUGIN_CLASS (klass);
   plugin_class->construct = separator_plugin_construct;
+  plugin_class->free_data = separator_plugin_free_data;
   plugin_class->size_changed = separator_plugin_size_changed;
   plugin_class->configure_plugin = separator_plugin_configure_plugin;
   plugin_class->orientation_changed = separator_plugin_orientation_changed;
@@ -155,6 +171,9 @@ static void
 separator_plugin_init (SeparatorPlugin *plugin)
 {
   plugin->style = SEPARATOR_PLUGIN_STYLE_DEFAULT;
+  plugin->dots_pixmap = NULL;
+  plugin->dots_mask = NULL;
+  plugin->dots_gc = NULL;
 }
 
 
@@ -204,6 +223,9 @@ separator_plugin_set_property (GObject      *object,
       if (plugin->style == SEPARATOR_PLUGIN_STYLE_WRAP)
         plugin->style = SEPARATOR_PLUGIN_STYLE_DEFAULT;
 
+      if (plugin->style != SEPARATOR_PLUGIN_STYLE_DOTS)
+        separator_plugin_dots_free (plugin);
+
       gtk_widget_queue_draw (GTK_WIDGET (object));
       break;
 
@@ -220,18 +242,107 @@ separator_plugin_set_property (GObject      *object,
 
 
 
+static void
+separator_plugin_dots_free (SeparatorPlugin *plugin)
+{
+  if (plugin->dots_pixmap != NULL)
+    {
+      g_object_unref (G_OBJECT (plugin->dots_pixmap));
+      plugin->dots_pixmap = NULL;
+    }
+
+  if (plugin->dots_mask != NULL)
+    {
+      g_object_unref (G_OBJECT (plugin->dots_mask));
+      plugin->dots_mask = NULL;
+    }
+
+  if (plugin->dots_gc != NULL)
+    {
+      g_object_unref (G_OBJECT (plugin->dots_gc));
+      plugin->dots_gc = NULL;
+    }
+}
+
+
+
+static void
+separator_plugin_dots_render (SeparatorPlugin *plugin,
+                              gint             w,
+                              gint             h,
+                              GtkStateType     state)
+{
+  GtkWidget *widget = GTK_WIDGET (plugin);
+  GdkBitmap *bmap;
+  GdkGC     *gc, *mask_gc;
+  GdkColor   color;
+  guint      i;
+
+  separator_plugin_dots_free (plugin);
+
+  plugin->dots_width = w;
+  plugin->dots_height = h;
+  plugin->dots_state = state;
+
+  plugin->dots_pixmap = gdk_pixmap_new (widget->window, w, h, -1);
+  plugin->dots_mask = gdk_pixmap_new (widget->window, w, h, 1);
+
+  /* start with an empty mask, the stipples add the dots */
+  mask_gc = gdk_gc_new (plugin->dots_mask);
+  color.pixel = 0;
+  gdk_gc_set_foreground (mask_gc, &color);
+  gdk_draw_rectangle (plugin->dots_mask, mask_gc, TRUE, 0, 0, w, h);
+  color.pixel = 1;
+  gdk_gc_set_foreground (mask_gc, &color);
+  gdk_gc_set_fill (mask_gc, GDK_STIPPLED);
+
+  for (i = 0; i < G_N_ELEMENTS (bits); i++)
+    {
+      /* pick color, but be same order as bits array */
+      if (i == 0)
+        gc = widget->style->dark_gc[state];
+      else if (i == 1)
+        gc = widget->style->light_gc[state];
+      else
+        gc = widget->style->mid_gc[state];
+
+      /* set the stipple for the gc */
+      bmap = gdk_bitmap_create_from_data (widget->window, bits[i],
+                                          DOTS_SIZE, DOTS_SIZE);
+      gdk_gc_set_stipple (gc, bmap);
+      gdk_gc_set_fill (gc, GDK_STIPPLED);
+
+      /* draw the dots */
+      gdk_gc_set_ts_origin (gc, 0, 0);
+      gdk_draw_rectangle (plugin->dots_pixmap, gc, TRUE, 0, 0, w, h);
+      gdk_gc_set_fill (gc, GDK_SOLID);
+
+      /* and add them to the mask */
+      gdk_gc_set_stipple (mask_gc, bmap);
+      gdk_draw_rectangle (plugin->dots_mask, mask_gc, TRUE, 0, 0, w, h);
+
+      g_object_unref (G_OBJECT (bmap));
+    }
+
+  g_object_unref (G_OBJECT (mask_gc));
+
+  /* gc to blit the pattern on the panel background */
+  plugin->dots_gc = gdk_gc_new (widget->window);
+  gdk_gc_set_clip_mask (plugin->dots_gc, plugin->dots_mask);
+}
+
+
+
 static gboolean
 separator_plugin_expose_event (GtkWidget      *widget,
                                GdkEventExpose *event)
 {
   SeparatorPlugin *plugin = XFCE_SEPARATOR_PLUGIN (widget);
   GtkAllocation   *alloc = &(widget->allocation);
-  GdkBitmap       *bmap;
-  GdkGC           *gc;
   GtkStateType     state = GTK_WIDGET_STATE (widget);
+  GdkRectangle     area;
   gint             x, y, w, h;
   gint             rows, cols;
-  guint            i;
 
   switch (plugin->style)
     {
@@ -244,6 +355,14 @@ separator_plugin_expose_event (GtkWidget      *widget,
       if (xfce_panel_plugin_get_orientation (XFCE_PANEL_PLUGIN (plugin)) ==
           GTK_ORIENTATION_HORIZONTAL)
         {
+          /* skip exposes that do not touch the line */
+          area.x = alloc->x + alloc->width / 2 - widget->style->xthickness - 1;
+          area.y = alloc->y;
+          area.width = widget->style->xthickness * 2 + 2;
+          area.height = alloc->height;
+          if (!gdk_rectangle_intersect (&area, &(event->area), &area))
+            break;
+
           gtk_paint_vline (widget->style,
                            widget->window,
                            state,
@@ -255,6 +374,13 @@ separator_plugin_expose_event (GtkWidget      *widget,
         }
       else
         {
+          area.x = alloc->x;
+          area.y = alloc->y + alloc->height / 2 - widget->style->ythickness - 1;
+          area.width = alloc->width;
+          area.height = widget->style->ythickness * 2 + 2;
+          if (!gdk_rectangle_intersect (&area, &(event->area), &area))
+            break;
+
           gtk_paint_hline (widget->style,
                            widget->window,
                            state,
@@ -299,34 +425,25 @@ separator_plugin_expose_event (GtkWidget      *widget,
       x = alloc->x + (alloc->width - w) / 2;
       y = alloc->y + (alloc->height - h) / 2;
 
-      for (i = 0; i < G_N_ELEMENTS (bits); i++)
-        {
-          /* pick color, but be same order as bits array */
-          if (i == 0)
-            gc = widget->style->dark_gc[state];
-          else if (i == 1)
-            gc = widget->style->light_gc[state];
-          else
-            gc = widget->style->mid_gc[state];
-
-          /* clip to drawing area */
-          gdk_gc_set_clip_rectangle (gc, &(event->area));
-
-          /* set the stipple for the gc */
-          bmap = gdk_bitmap_create_from_data (widget->window, bits[i],
-                                              DOTS_SIZE, DOTS_SIZE);
-          gdk_gc_set_stipple (gc, bmap);
-          gdk_gc_set_fill (gc, GDK_STIPPLED);
-          g_object_unref (G_OBJECT (bmap));
-
-          /* draw the dots */
-          gdk_gc_set_ts_origin (gc, x, y);
-          gdk_draw_rectangle (widget->window, gc, TRUE, x, y, w, h);
-          gdk_gc_set_fill (gc, GDK_SOLID);
-
-          /* unset the clip */
-          gdk_gc_set_clip_rectangle (gc, NULL);
-        }
+      /* only copy the part of the dots that was exposed */
+      area.x = x;
+      area.y = y;
+      area.width = w;
+      area.height = h;
+      if (!gdk_rectangle_intersect (&area, &(event->area), &area))
+        break;
+
+      /* render the pattern once for this size and state */
+      if (plugin->dots_pixmap == NULL
+          || plugin->dots_width != w
+          || plugin->dots_height != h
+          || plugin->dots_state != state)
+        separator_plugin_dots_render (plugin, w, h, state);
+
+      gdk_gc_set_clip_origin (plugin->dots_gc, x, y);
+      gdk_draw_drawable (widget->window, plugin->dots_gc, plugin->dots_pixmap,
+                         area.x - x, area.y - y, area.x, area.y,
+                         area.width, area.height);
       break;
     }
 
@@ -335,6 +452,30 @@ separator_plugin_expose_event (GtkWidget      *widget,
 
 
 
+static void
+separator_plugin_style_set (GtkWidget *widget,
+                            GtkStyle  *previous_style)
+{
+  /* the dots use the colors of the style */
+  separator_plugin_dots_free (XFCE_SEPARATOR_PLUGIN (widget));
+
+  if (GTK_WIDGET_CLASS (separator_plugin_parent_class)->style_set != NULL)
+    (*GTK_WIDGET_CLASS (separator_plugin_parent_class)->style_set) (widget, previous_style);
+}
+
+
+
+static void
+separator_plugin_unrealize (GtkWidget *widget)
+{
+  /* the pixmaps belong to the window */
+  separator_plugin_dots_free (XFCE_SEPARATOR_PLUGIN (widget));
+
+  (*GTK_WIDGET_CLASS (separator_plugin_parent_class)->unrealize) (widget);
+}
+
+
+
 static void
 separator_plugin_construct (XfcePanelPlugin *panel_plugin)
 {
@@ -361,6 +502,14 @@ separator_plugin_construct (XfcePanelPlugin *panel_plugin)
 
 
 
+static void
+separator_plugin_free_data (XfcePanelPlugin *panel_plugin)
+{
+  separator_plugin_dots_free (XFCE_SEPARATOR_PLUGIN (panel_plugin));
+}
+
+
+
 static gboolean
 separator_plugin_size_changed (XfcePanelPlugin *panel_plugin,
                                gint             size)
@@ -25,6 +25,11 @@
 #include <common/panel-private.h>
 #include <common/panel-utils.h>
 
+#ifdef GDK_WINDOWING_X11
+#include <X11/Xlib.h>
+#include <gdk/gdkx.h>
+#endif
+
 #include "showdesktop.h"
 
 
@@ -42,6 +47,8 @@ static gboolean show_desktop_plugin_button_release_event    (GtkToggleButton
                                                              ShowDesktopPlugin      *plugin);
 static void     show_desktop_plugin_showing_desktop_changed (WnckScreen             *wnck_screen,
                                                              ShowDesktopPlugin      *plugin);
+static void     show_desktop_plugin_windows_connect         (ShowDesktopPlugin      *plugin);
+static void     show_desktop_plugin_windows_disconnect      (ShowDesktopPlugin      *plugin);
 
 
 
@@ -59,6 +66,10 @@ struct _ShowDesktopPlugin
 
   /* the wnck screen */
   WnckScreen *wnck_screen;
+
+  /* workspace of each window and the windows per workspace */
+  GHashTable *windows;
+  GHashTable *workspaces;
 };
 
 
@@ -87,6 +98,8 @@ show_desktop_plugin_init (ShowDesktopPlugin *plugin)
   GtkWidget *button, *image;
 
   plugin->wnck_screen = NULL;
+  plugin->windows = NULL;
+  plugin->workspaces = NULL;
 
   /* monitor screen changes */
   g_signal_connect (G_OBJECT (plugin), "screen-changed",
@@ -140,13 +153,17 @@ show_desktop_plugin_screen_changed (GtkWidget *widget,
 
   /* disconnect signals from an existing wnck screen */
   if (plugin->wnck_screen != NULL)
-    g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
-        show_desktop_plugin_showing_desktop_changed, plugin);
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
+          show_desktop_plugin_showing_desktop_changed, plugin);
+      show_desktop_plugin_windows_disconnect (plugin);
+    }
 
   /* set the new wnck screen */
   plugin->wnck_screen = wnck_screen;
   g_signal_connect (G_OBJECT (wnck_screen), "showing-desktop-changed",
       G_CALLBACK (show_desktop_plugin_showing_desktop_changed), plugin);
+  show_desktop_plugin_windows_connect (plugin);
 
   /* toggle the button to the current state or update the tooltip */
   if (G_UNLIKELY (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (plugin->button)) !=
@@ -169,8 +186,11 @@ show_desktop_plugin_free_data (XfcePanelPlugin *panel_plugin)
 
   /* disconnect handle */
   if (plugin->wnck_screen != NULL)
-    g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
-        show_desktop_plugin_showing_desktop_changed, plugin);
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
+          show_desktop_plugin_showing_desktop_changed, plugin);
+      show_desktop_plugin_windows_disconnect (plugin);
+    }
 }
 
 
@@ -190,6 +210,216 @@ show_desktop_plugin_size_changed (XfcePanelPlugin *panel_plugin,
 
 
 
+static void
+show_desktop_plugin_windows_remove (ShowDesktopPlugin *plugin,
+                                    WnckWindow        *window)
+{
+  WnckWorkspace *workspace;
+  GSList        *windows;
+
+  if (!g_hash_table_lookup_extended (plugin->windows, window,
+                                     NULL, (gpointer *) &workspace))
+    return;
+
+  g_hash_table_remove (plugin->windows, window);
+
+  /* pinned windows are not in a workspace list */
+  if (workspace == NULL)
+    return;
+
+  /* steal the list, so the table does not free it */
+  windows = g_hash_table_lookup (plugin->workspaces, workspace);
+  g_hash_table_steal (plugin->workspaces, workspace);
+  windows = g_slist_remove (windows, window);
+  if (windows != NULL)
+    g_hash_table_insert (plugin->workspaces, workspace, windows);
+}
+
+
+
+static void
+show_desktop_plugin_windows_insert (ShowDesktopPlugin *plugin,
+                                    WnckWindow        *window)
+{
+  WnckWorkspace *workspace;
+  GSList        *windows;
+
+  workspace = wnck_window_get_workspace (window);
+  g_hash_table_insert (plugin->windows, window, workspace);
+
+  if (workspace != NULL)
+    {
+      windows = g_hash_table_lookup (plugin->workspaces, workspace);
+      g_hash_table_steal (plugin->workspaces, workspace);
+      windows = g_slist_prepend (windows, window);
+      g_hash_table_insert (plugin->workspaces, workspace, windows);
+    }
+}
+
+
+
+static void
+show_desktop_plugin_window_workspace_changed (WnckWindow        *window,
+                                              ShowDesktopPlugin *plugin)
+{
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+
+  show_desktop_plugin_windows_remove (plugin, window);
+  show_desktop_plugin_windows_insert (plugin, window);
+}
+
+
+
+static void
+show_desktop_plugin_window_opened (WnckScreen        *wnck_screen,
+                                   WnckWindow        *window,
+                                   ShowDesktopPlugin *plugin)
+{
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+
+  show_desktop_plugin_windows_insert (plugin, window);
+  g_signal_connect (G_OBJECT (window), "workspace-changed",
+      G_CALLBACK (show_desktop_plugin_window_workspace_changed), plugin);
+}
+
+
+
+static void
+show_desktop_plugin_window_closed (WnckScreen        *wnck_screen,
+                                   WnckWindow        *window,
+                                   ShowDesktopPlugin *plugin)
+{
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (window),
+      show_desktop_plugin_window_workspace_changed, plugin);
+  show_desktop_plugin_windows_remove (plugin, window);
+}
+
+
+
+static void
+show_desktop_plugin_windows_connect (ShowDesktopPlugin *plugin)
+{
+  GList *li;
+
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->wnck_screen));
+
+  plugin->windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+  plugin->workspaces = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                              NULL, (GDestroyNotify) g_slist_free);
+
+  g_signal_connect (G_OBJECT (plugin->wnck_screen), "window-opened",
+      G_CALLBACK (show_desktop_plugin_window_opened), plugin);
+  g_signal_connect (G_OBJECT (plugin->wnck_screen), "window-closed",
+      G_CALLBACK (show_desktop_plugin_window_closed), plugin);
+
+  /* index the existing windows */
+  for (li = wnck_screen_get_windows (plugin->wnck_screen); li != NULL; li = li->next)
+    show_desktop_plugin_window_opened (plugin->wnck_screen, WNCK_WINDOW (li->data), plugin);
+}
+
+
+
+static void
+show_desktop_plugin_windows_disconnect (ShowDesktopPlugin *plugin)
+{
+  GHashTableIter iter;
+  gpointer       window;
+
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->wnck_screen));
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
+      show_desktop_plugin_window_opened, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->wnck_screen),
+      show_desktop_plugin_window_closed, plugin);
+
+  g_hash_table_iter_init (&iter, plugin->windows);
+  while (g_hash_table_iter_next (&iter, &window, NULL))
+    g_signal_handlers_disconnect_by_func (G_OBJECT (window),
+        show_desktop_plugin_window_workspace_changed, plugin);
+
+  g_hash_table_destroy (plugin->windows);
+  plugin->windows = NULL;
+  g_hash_table_destroy (plugin->workspaces);
+  plugin->workspaces = NULL;
+}
+
+
+
+static void
+show_desktop_plugin_windows_toggle_shade (ShowDesktopPlugin *plugin,
+                                          GSList            *windows)
+{
+  GSList     *li;
+  WnckWindow *window;
+#ifdef GDK_WINDOWING_X11
+  GdkDisplay *display;
+  Display    *dpy;
+  Window      root;
+  XEvent      xev;
+#endif
+
+  panel_return_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin));
+
+  if (windows == NULL)
+    return;
+
+#ifdef GDK_WINDOWING_X11
+  display = gtk_widget_get_display (GTK_WIDGET (plugin));
+  dpy = GDK_DISPLAY_XDISPLAY (display);
+  root = GDK_WINDOW_XID (gdk_screen_get_root_window (
+      gtk_widget_get_screen (GTK_WIDGET (plugin))));
+
+  xev.xclient.type = ClientMessage;
+  xev.xclient.serial = 0;
+  xev.xclient.send_event = True;
+  xev.xclient.display = dpy;
+  xev.xclient.message_type = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE");
+  xev.xclient.format = 32;
+  xev.xclient.data.l[1] = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_SHADED");
+  xev.xclient.data.l[2] = 0;
+  xev.xclient.data.l[3] = 2; /* pager source indication */
+  xev.xclient.data.l[4] = 0;
+
+  /* wnck syncs with the server after each request, send all
+   * state changes and wait for errors only once */
+  gdk_error_trap_push ();
+
+  for (li = windows; li != NULL; li = li->next)
+    {
+      window = WNCK_WINDOW (li->data);
+
+      xev.xclient.window = wnck_window_get_xid (window);
+      xev.xclient.data.l[0] = wnck_window_is_shaded (window) ? 0 : 1;
+
+      XSendEvent (dpy, root, False,
+                  SubstructureRedirectMask | SubstructureNotifyMask, &xev);
+    }
+
+  gdk_flush ();
+  if (gdk_error_trap_pop () != 0)
+    g_warning ("Failed to change the shade state of the windows");
+#else
+  for (li = windows; li != NULL; li = li->next)
+    {
+      window = WNCK_WINDOW (li->data);
+
+      if (wnck_window_is_shaded (window))
+        wnck_window_unshade (window);
+      else
+        wnck_window_shade (window);
+    }
+#endif
+}
+
+
+
 static void
 show_desktop_plugin_toggled (GtkToggleButton   *button,
                              ShowDesktopPlugin *plugin)
@@ -223,29 +453,19 @@ show_desktop_plugin_button_release_event (GtkToggleButton   *button,
                                           ShowDesktopPlugin *plugin)
 {
   WnckWorkspace *active_ws;
-  GList         *windows, *li;
-  WnckWindow    *window;
+  GSList        *windows;
 
   panel_return_val_if_fail (XFCE_IS_SHOW_DESKTOP_PLUGIN (plugin), FALSE);
   panel_return_val_if_fail (WNCK_IS_SCREEN (plugin->wnck_screen), FALSE);
 
   if (event->button == 2)
     {
+      /* toggle the shade state of the windows on this workspace */
       active_ws = wnck_screen_get_active_workspace (plugin->wnck_screen);
-      windows = wnck_screen_get_windows (plugin->wnck_screen);
-
-      for (li = windows; li != NULL; li = li->next)
+      if (active_ws != NULL)
         {
-          window = WNCK_WINDOW (li->data);
-
-          if (wnck_window_get_workspace (window) != active_ws)
-            continue;
-
-          /* toggle the shade state */
-          if (wnck_window_is_shaded (window))
-            wnck_window_unshade (window);
-          else
-            wnck_window_shade (window);
+          windows = g_hash_table_lookup (plugin->workspaces, active_ws);
+          show_desktop_plugin_windows_toggle_shade (plugin, windows);
         }
     }
 
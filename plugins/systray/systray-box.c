@@ -39,9 +39,20 @@
 #define SPACING    (2)
 #define OFFSCREEN  (-9999)
 
+/* fixed point units of the single row cells, so adding and
+ * removing non-squared icons leaves no rounding residue */
+#define CELL_UNITS (65536)
+
 /* some icon implementations request a 1x1 size for invisible icons */
 #define REQUISITION_IS_INVISIBLE(child_req) ((child_req).width <= 1 && (child_req).height <= 1)
 
+#define ALLOCATION_EQUAL(a,b) ((a).x == (b).x && (a).y == (b).y \
+                               && (a).width == (b).width && (a).height == (b).height)
+
+
+
+typedef struct _SystrayBoxChild SystrayBoxChild;
+
 
 
 static void     systray_box_get_property          (GObject         *object,
@@ -64,6 +75,7 @@ static void     systray_box_forall                (GtkContainer    *container,
 static GType    systray_box_child_type            (GtkContainer    *container);
 static gint     systray_box_compare_function      (gconstpointer    a,
                                                    gconstpointer    b);
+static void     systray_box_layout_invalidate     (SystrayBox      *box);
 
 
 
@@ -82,7 +94,7 @@ struct _SystrayBox
 {
   GtkContainer  __parent__;
 
-  /* all the icons packed in this box */
+  /* all the icons packed in this box (SystrayBoxChild) */
   GSList       *childeren;
 
   /* orientation of the box */
@@ -100,6 +112,48 @@ struct _SystrayBox
 
   /* allocated size by the plugin */
   gint          size_alloc;
+
+  /* packed grid model, updated for each icon that changed */
+  gint          n_packed;
+  gint          grid_n_hidden;
+  gint          cells_single;
+  gdouble       cells_multi;
+  gint          min_seq_cells;
+  guint         grid_invalid : 1;
+
+  /* geometry of the last allocation */
+  GtkAllocation last_alloc;
+  gint          last_rows;
+  gint          last_row_size;
+  guint         layout_invalid : 1;
+
+  /* number of full and incremental relayouts */
+  guint         n_full_layouts;
+  guint         n_incremental_layouts;
+};
+
+struct _SystrayBoxChild
+{
+  GtkWidget      *widget;
+
+  /* cached requisition and state of the icon */
+  GtkRequisition  req;
+  guint           visible : 1;
+  guint           hidden : 1;
+
+  /* whether the icon is accounted in the grid model */
+  guint           packed : 1;
+
+  /* requisition or state changed since the last allocation */
+  guint           dirty : 1;
+
+  /* number of cells the icon occupies in a single row, 0.00 if
+   * the icon is not shown in the box */
+  gdouble         ratio;
+
+  /* allocation of the icon in the current and the last layout */
+  GtkAllocation   slot;
+  GtkAllocation   alloc;
 };
 
 
@@ -151,6 +205,17 @@ systray_box_init (SystrayBox *box)
   box->n_visible_children = 0;
   box->horizontal = TRUE;
   box->show_hidden = FALSE;
+  box->n_packed = 0;
+  box->grid_n_hidden = 0;
+  box->cells_single = 0;
+  box->cells_multi = 0.00;
+  box->min_seq_cells = -1;
+  box->grid_invalid = FALSE;
+  box->last_rows = 0;
+  box->last_row_size = 0;
+  box->layout_invalid = TRUE;
+  box->n_full_layouts = 0;
+  box->n_incremental_layouts = 0;
 }
 
 
@@ -181,11 +246,14 @@ static void
 systray_box_finalize (GObject *object)
 {
   SystrayBox *box = XFCE_SYSTRAY_BOX (object);
+  GSList     *li;
 
   /* check if we're leaking */
   if (G_UNLIKELY (box->childeren != NULL))
     {
       /* free the child list */
+      for (li = box->childeren; li != NULL; li = li->next)
+        g_slice_free (SystrayBoxChild, li->data);
       g_slist_free (box->childeren);
       g_debug ("Not all icons has been removed from the systray.");
     }
@@ -243,86 +311,184 @@ systray_box_size_get_max_child_size (SystrayBox *box,
 
 
 
+static void
+systray_box_child_pack (SystrayBox      *box,
+                        SystrayBoxChild *child,
+                        gint             sign)
+{
+  gdouble cells;
+
+  /* add (sign = 1) or remove (sign = -1) the contribution of
+   * this child in the grid model */
+  if (child->visible && child->hidden)
+    box->grid_n_hidden += sign;
+
+  if (child->ratio <= 0.00)
+    return;
+
+  box->n_packed += sign;
+  box->cells_single += sign * (gint) rint (child->ratio * CELL_UNITS);
+
+  if (child->ratio > 1.00)
+    {
+      /* non-squared icons are aligned to whole blocks if we have
+       * multiple rows */
+      cells = ceil (child->ratio);
+      box->cells_multi += sign * cells;
+
+      if (sign > 0)
+        box->min_seq_cells = MAX (box->min_seq_cells, (gint) cells);
+      else if ((gint) cells >= box->min_seq_cells)
+        box->grid_invalid = TRUE;
+    }
+  else
+    {
+      box->cells_multi += sign * child->ratio;
+      box->n_visible_children += sign;
+    }
+}
+
+
+
+static gboolean
+systray_box_child_update (SystrayBox      *box,
+                          SystrayBoxChild *child)
+{
+  GtkRequisition child_req;
+  gboolean       visible;
+  gboolean       hidden;
+  gdouble        ratio = 0.00;
+
+  gtk_widget_size_request (child->widget, &child_req);
+
+  /* skip invisible requisitions (see macro) or hidden widgets */
+  visible = !REQUISITION_IS_INVISIBLE (child_req)
+            && GTK_WIDGET_VISIBLE (child->widget);
+  hidden = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child->widget));
+
+  /* if we show hidden icons */
+  if (visible && (!hidden || box->show_hidden))
+    {
+      ratio = 1.00;
+
+      /* special handling for non-squared icons. this only works if
+       * the icon size ratio is > 1.00, if this is lower then 1.00
+       * the icon implementation should respect the tray orientation */
+      if (G_UNLIKELY (child_req.width != child_req.height))
+        {
+          ratio = (gdouble) child_req.width / (gdouble) child_req.height;
+          if (!box->horizontal)
+            ratio = 1 / ratio;
+
+          if (ratio <= 1.00)
+            ratio = 1.00;
+        }
+    }
+
+  /* nothing changed for this icon */
+  if (child->packed
+      && child->req.width == child_req.width
+      && child->req.height == child_req.height
+      && child->visible == visible
+      && child->hidden == hidden
+      && child->ratio == ratio)
+    return FALSE;
+
+  if (child->packed)
+    systray_box_child_pack (box, child, -1);
+
+  child->req = child_req;
+  child->visible = visible;
+  child->hidden = hidden;
+  child->ratio = ratio;
+  child->packed = TRUE;
+  child->dirty = TRUE;
+
+  systray_box_child_pack (box, child, 1);
+
+  return TRUE;
+}
+
+
+
+static void
+systray_box_grid_rebuild (SystrayBox *box)
+{
+  GSList *li;
+
+  box->n_packed = 0;
+  box->grid_n_hidden = 0;
+  box->n_visible_children = 0;
+  box->cells_single = 0;
+  box->cells_multi = 0.00;
+  box->min_seq_cells = -1;
+  box->grid_invalid = FALSE;
+
+  for (li = box->childeren; li != NULL; li = li->next)
+    {
+      ((SystrayBoxChild *) li->data)->packed = FALSE;
+      systray_box_child_update (box, li->data);
+    }
+}
+
+
+
 static void
 systray_box_size_request (GtkWidget      *widget,
                           GtkRequisition *requisition)
 {
   SystrayBox     *box = XFCE_SYSTRAY_BOX (widget);
-  GtkWidget      *child;
   gint            border;
-  GtkRequisition  child_req;
-  gint            n_hidden_childeren = 0;
   gint            rows;
   gdouble         cols;
   gint            row_size;
   gdouble         cells;
   gint            min_seq_cells = -1;
-  gdouble         ratio;
   GSList         *li;
-  gboolean        hidden;
   gint            col_px;
   gint            row_px;
-
-  box->n_visible_children = 0;
+  gint            n_changed = 0;
 
   /* get some info about the n_rows we're going to allocate */
   systray_box_size_get_max_child_size (box, box->size_alloc, &rows, &row_size, NULL);
 
-  for (li = box->childeren, cells = 0.00; li != NULL; li = li->next)
+  if (G_UNLIKELY (box->grid_invalid))
     {
-      child = GTK_WIDGET (li->data);
-      panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (child));
-
-      gtk_widget_size_request (child, &child_req);
-
-      /* skip invisible requisitions (see macro) or hidden widgets */
-      if (REQUISITION_IS_INVISIBLE (child_req)
-          || !GTK_WIDGET_VISIBLE (child))
-        continue;
-
-      hidden = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child));
-      if (hidden)
-        n_hidden_childeren++;
+      systray_box_grid_rebuild (box);
+    }
+  else
+    {
+      /* only update the grid for the icons that changed */
+      for (li = box->childeren; li != NULL; li = li->next)
+        if (systray_box_child_update (box, li->data))
+          n_changed++;
+
+      /* removing the widest icon invalidates the sequential cells */
+      if (G_UNLIKELY (box->grid_invalid))
+        systray_box_grid_rebuild (box);
+    }
 
-      /* if we show hidden icons */
-      if (!hidden || box->show_hidden)
+  if (box->n_packed > 0)
+    {
+      if (rows > 1)
         {
-          /* special handling for non-squared icons. this only works if
-           * the icon size ratio is > 1.00, if this is lower then 1.00
-           * the icon implementation should respect the tray orientation */
-          if (G_UNLIKELY (child_req.width != child_req.height))
-            {
-              ratio = (gdouble) child_req.width / (gdouble) child_req.height;
-              if (!box->horizontal)
-                ratio = 1 / ratio;
-
-              if (ratio > 1.00)
-                {
-                  if (G_UNLIKELY (rows > 1))
-                    {
-                      /* align to whole blocks if we have multiple rows */
-                      ratio = ceil (ratio);
-
-                      /* update the min sequential number of blocks */
-                      min_seq_cells = MAX (min_seq_cells, ratio);
-                    }
-
-                  cells += ratio;
-
-                  continue;
-                }
-            }
-
-          /* don't do anything with the actual size,
-           * just count the number of cells */
-          cells += 1.00;
-          box->n_visible_children++;
+          cells = box->cells_multi;
+          min_seq_cells = box->min_seq_cells;
+        }
+      else
+        {
+          cells = (gdouble) box->cells_single / CELL_UNITS;
         }
     }
+  else
+    {
+      /* avoid rounding errors in the incremental sums */
+      cells = 0.00;
+    }
 
   panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
-      "requested cells=%g, rows=%d, row_size=%d, children=%d",
-      cells, rows, row_size, box->n_visible_children);
+      "requested cells=%g, rows=%d, row_size=%d, children=%d, changed=%d",
+      cells, rows, row_size, box->n_visible_children, n_changed);
 
   if (cells > 0.00)
     {
@@ -357,13 +523,13 @@ systray_box_size_request (GtkWidget      *widget,
     }
 
   /* emit property if changed */
-  if (box->n_hidden_childeren != n_hidden_childeren)
+  if (box->n_hidden_childeren != box->grid_n_hidden)
     {
       panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
           "hidden children changed (%d -> %d)",
-          n_hidden_childeren, box->n_hidden_childeren);
+          box->n_hidden_childeren, box->grid_n_hidden);
 
-      box->n_hidden_childeren = n_hidden_childeren;
+      box->n_hidden_childeren = box->grid_n_hidden;
       g_object_notify (G_OBJECT (box), "has-hidden");
     }
 
@@ -379,20 +545,26 @@ static void
 systray_box_size_allocate (GtkWidget     *widget,
                            GtkAllocation *allocation)
 {
-  SystrayBox     *box = XFCE_SYSTRAY_BOX (widget);
-  GtkWidget      *child;
-  GtkAllocation   child_alloc;
-  GtkRequisition  child_req;
-  gint            border;
-  gint            rows;
-  gint            row_size;
-  gdouble         ratio;
-  gint            x, x_start, x_end;
-  gint            y, y_start, y_end;
-  gint            offset;
-  GSList         *li;
-  gint            alloc_size;
-  gint            idx;
+  SystrayBox      *box = XFCE_SYSTRAY_BOX (widget);
+  SystrayBoxChild *child;
+  GtkAllocation   *child_alloc;
+  gint             border;
+  gint             rows;
+  gint             row_size;
+  gdouble          ratio;
+  gint             x, x_start, x_end;
+  gint             y, y_start, y_end;
+  gint             offset;
+  GSList          *li;
+  gint             alloc_size;
+  gint             idx;
+  gboolean         full_layout;
+  gint             n_allocated = 0;
+
+  /* a full relayout is needed if the geometry of the box changed,
+   * otherwise only the icons that moved or changed are allocated */
+  full_layout = box->layout_invalid
+                || !ALLOCATION_EQUAL (*allocation, box->last_alloc);
 
   widget->allocation = *allocation;
 
@@ -402,6 +574,14 @@ systray_box_size_allocate (GtkWidget     *widget,
 
   systray_box_size_get_max_child_size (box, alloc_size, &rows, &row_size, &offset);
 
+  if (rows != box->last_rows || row_size != box->last_row_size)
+    full_layout = TRUE;
+
+  box->last_alloc = *allocation;
+  box->last_rows = rows;
+  box->last_row_size = row_size;
+  box->layout_invalid = FALSE;
+
   panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "allocate rows=%d, row_size=%d, w=%d, h=%d, horiz=%s, border=%d",
                         rows, row_size, allocation->width, allocation->height,
                         PANEL_DEBUG_BOOL (box->horizontal), border);
@@ -424,76 +604,76 @@ systray_box_size_allocate (GtkWidget     *widget,
   x = x_start;
   y = y_start;
 
+  /* compute the slot of each icon in the grid, the allocation
+   * is only applied once the whole layout fits */
   for (li = box->childeren; li != NULL; li = li->next)
     {
-      child = GTK_WIDGET (li->data);
-      panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (child));
+      child = li->data;
+      panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (child->widget));
 
-      if (!GTK_WIDGET_VISIBLE (child))
+      if (!GTK_WIDGET_VISIBLE (child->widget))
         continue;
 
-      gtk_widget_get_child_requisition (child, &child_req);
+      child_alloc = &child->slot;
 
-      if (REQUISITION_IS_INVISIBLE (child_req)
-          || (!box->show_hidden
-              && systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (child))))
+      if (child->ratio <= 0.00)
         {
           /* position hidden icons offscreen if we don't show hidden icons
            * or the requested size looks like an invisible icons (see macro) */
-          child_alloc.x = child_alloc.y = OFFSCREEN;
+          child_alloc->x = child_alloc->y = OFFSCREEN;
 
           /* some implementations (hi nm-applet) start their setup on
            * a size-changed signal, so make sure this event is triggered
            * by allocation a normal size instead of 1x1 */
-          child_alloc.width = child_alloc.height = row_size;
+          child_alloc->width = child_alloc->height = row_size;
         }
       else
         {
           /* special case handling for non-squared icons */
-          if (G_UNLIKELY (child_req.width != child_req.height))
+          if (G_UNLIKELY (child->req.width != child->req.height))
             {
-              ratio = (gdouble) child_req.width / (gdouble) child_req.height;
+              ratio = (gdouble) child->req.width / (gdouble) child->req.height;
 
               if (box->horizontal)
                 {
-                  child_alloc.height = row_size;
-                  child_alloc.width = row_size * ratio;
-                  child_alloc.y = child_alloc.x = 0;
+                  child_alloc->height = row_size;
+                  child_alloc->width = row_size * ratio;
+                  child_alloc->y = child_alloc->x = 0;
 
                   if (rows > 1)
                     {
                       ratio = ceil (ratio);
-                      child_alloc.x = ((ratio * row_size) - child_alloc.width) / 2;
+                      child_alloc->x = ((ratio * row_size) - child_alloc->width) / 2;
                     }
                 }
               else
                 {
                   ratio = 1 / ratio;
 
-                  child_alloc.width = row_size;
-                  child_alloc.height = row_size * ratio;
-                  child_alloc.x = child_alloc.y = 0;
+                  child_alloc->width = row_size;
+                  child_alloc->height = row_size * ratio;
+                  child_alloc->x = child_alloc->y = 0;
 
                   if (rows > 1)
                     {
                       ratio = ceil (ratio);
-                      child_alloc.y = ((ratio * row_size) - child_alloc.height) / 2;
+                      child_alloc->y = ((ratio * row_size) - child_alloc->height) / 2;
                     }
                 }
             }
           else
             {
               /* fix icon to row size */
-              child_alloc.width = row_size;
-              child_alloc.height = row_size;
-              child_alloc.x = 0;
-              child_alloc.y = 0;
+              child_alloc->width = row_size;
+              child_alloc->height = row_size;
+              child_alloc->x = 0;
+              child_alloc->y = 0;
 
               ratio = 1.00;
             }
 
-          if ((box->horizontal && x + child_alloc.width > x_end)
-              || (!box->horizontal && y + child_alloc.height > y_end))
+          if ((box->horizontal && x + child_alloc->width > x_end)
+              || (!box->horizontal && y + child_alloc->height > y_end))
             {
               if (ratio >= 2
                   && li->next != NULL)
@@ -546,21 +726,72 @@ systray_box_size_allocate (GtkWidget     *widget,
                 }
             }
 
-          child_alloc.x += x;
-          child_alloc.y += y;
+          child_alloc->x += x;
+          child_alloc->y += y;
 
           if (box->horizontal)
             x += row_size * ratio + SPACING;
           else
             y += row_size * ratio + SPACING;
         }
+    }
+
+  /* allocate the icons that changed position, size or requisition */
+  for (li = box->childeren; li != NULL; li = li->next)
+    {
+      child = li->data;
+
+      if (!GTK_WIDGET_VISIBLE (child->widget))
+        continue;
+
+      if (!full_layout
+          && !child->dirty
+          && ALLOCATION_EQUAL (child->slot, child->alloc))
+        continue;
 
       panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "allocated %s[%p] at (%d,%d;%d,%d)",
-          systray_socket_get_name (XFCE_SYSTRAY_SOCKET (child)), child,
-          child_alloc.x, child_alloc.y, child_alloc.width, child_alloc.height);
+          systray_socket_get_name (XFCE_SYSTRAY_SOCKET (child->widget)), child->widget,
+          child->slot.x, child->slot.y, child->slot.width, child->slot.height);
+
+      child->alloc = child->slot;
+      child->dirty = FALSE;
+      n_allocated++;
 
-      gtk_widget_size_allocate (child, &child_alloc);
+      gtk_widget_size_allocate (child->widget, &child->alloc);
     }
+
+  if (full_layout)
+    box->n_full_layouts++;
+  else
+    box->n_incremental_layouts++;
+
+  panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+      "%s layout, allocated %d icons (full=%u, incremental=%u)",
+      full_layout ? "full" : "incremental", n_allocated,
+      box->n_full_layouts, box->n_incremental_layouts);
+}
+
+
+
+static SystrayBoxChild *
+systray_box_get_child (SystrayBox *box,
+                       GtkWidget  *widget,
+                       GSList    **link_ret)
+{
+  GSList *li;
+
+  for (li = box->childeren; li != NULL; li = li->next)
+    {
+      if (((SystrayBoxChild *) li->data)->widget == widget)
+        {
+          if (link_ret != NULL)
+            *link_ret = li;
+
+          return li->data;
+        }
+    }
+
+  return NULL;
 }
 
 
@@ -569,13 +800,18 @@ static void
 systray_box_add (GtkContainer *container,
                  GtkWidget    *child)
 {
-  SystrayBox *box = XFCE_SYSTRAY_BOX (container);
+  SystrayBox      *box = XFCE_SYSTRAY_BOX (container);
+  SystrayBoxChild *box_child;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_BOX (box));
   panel_return_if_fail (GTK_IS_WIDGET (child));
   panel_return_if_fail (child->parent == NULL);
 
-  box->childeren = g_slist_insert_sorted (box->childeren, child,
+  box_child = g_slice_new0 (SystrayBoxChild);
+  box_child->widget = child;
+  box_child->dirty = TRUE;
+
+  box->childeren = g_slist_insert_sorted (box->childeren, box_child,
                                           systray_box_compare_function);
 
   gtk_widget_set_parent (child, GTK_WIDGET (box));
@@ -589,17 +825,23 @@ static void
 systray_box_remove (GtkContainer *container,
                     GtkWidget    *child)
 {
-  SystrayBox *box = XFCE_SYSTRAY_BOX (container);
-  GSList     *li;
+  SystrayBox      *box = XFCE_SYSTRAY_BOX (container);
+  SystrayBoxChild *box_child;
+  GSList          *li = NULL;
 
   /* search the child */
-  li = g_slist_find (box->childeren, child);
-  if (G_LIKELY (li != NULL))
+  box_child = systray_box_get_child (box, child, &li);
+  if (G_LIKELY (box_child != NULL))
     {
-      panel_assert (GTK_WIDGET (li->data) == child);
+      panel_assert (box_child->widget == child);
+
+      /* remove the icon from the grid model */
+      if (box_child->packed)
+        systray_box_child_pack (box, box_child, -1);
 
       /* unparent widget */
-      box->childeren = g_slist_remove_link (box->childeren, li);
+      box->childeren = g_slist_delete_link (box->childeren, li);
+      g_slice_free (SystrayBoxChild, box_child);
       gtk_widget_unparent (child);
 
       /* resize, so we update has-hidden */
@@ -622,7 +864,7 @@ systray_box_forall (GtkContainer *container,
   for (li = box->childeren; li != NULL; li = lnext)
     {
       lnext = li->next;
-      (*callback) (GTK_WIDGET (li->data), callback_data);
+      (*callback) (((SystrayBoxChild *) li->data)->widget, callback_data);
     }
 }
 
@@ -641,18 +883,22 @@ static gint
 systray_box_compare_function (gconstpointer a,
                               gconstpointer b)
 {
-  const gchar *name_a, *name_b;
-  gboolean     hidden_a, hidden_b;
+  SystraySocket *socket_a, *socket_b;
+  const gchar   *name_a, *name_b;
+  gboolean       hidden_a, hidden_b;
+
+  socket_a = XFCE_SYSTRAY_SOCKET (((const SystrayBoxChild *) a)->widget);
+  socket_b = XFCE_SYSTRAY_SOCKET (((const SystrayBoxChild *) b)->widget);
 
   /* sort hidden icons before visible ones */
-  hidden_a = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (a));
-  hidden_b = systray_socket_get_hidden (XFCE_SYSTRAY_SOCKET (b));
+  hidden_a = systray_socket_get_hidden (socket_a);
+  hidden_b = systray_socket_get_hidden (socket_b);
   if (hidden_a != hidden_b)
     return hidden_a ? 1 : -1;
 
   /* sort icons by name */
-  name_a = systray_socket_get_name (XFCE_SYSTRAY_SOCKET (a));
-  name_b = systray_socket_get_name (XFCE_SYSTRAY_SOCKET (b));
+  name_a = systray_socket_get_name (socket_a);
+  name_b = systray_socket_get_name (socket_b);
 
 #if GLIB_CHECK_VERSION (2, 16, 0)
   return g_strcmp0 (name_a, name_b);
@@ -668,6 +914,18 @@ systray_box_compare_function (gconstpointer a,
 
 
 
+static void
+systray_box_layout_invalidate (SystrayBox *box)
+{
+  /* the grid model handles changed icons itself, but all
+   * icons have to be allocated again */
+  box->layout_invalid = TRUE;
+
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+}
+
+
+
 GtkWidget *
 systray_box_new (void)
 {
@@ -690,7 +948,7 @@ systray_box_set_orientation (SystrayBox     *box,
       box->horizontal = horizontal;
 
       if (box->childeren != NULL)
-        gtk_widget_queue_resize (GTK_WIDGET (box));
+        systray_box_layout_invalidate (box);
     }
 }
 
@@ -709,7 +967,7 @@ systray_box_set_size_max (SystrayBox *box,
       box->size_max = size_max;
 
       if (box->childeren != NULL)
-        gtk_widget_queue_resize (GTK_WIDGET (box));
+        systray_box_layout_invalidate (box);
     }
 }
 
@@ -736,7 +994,7 @@ systray_box_set_size_alloc (SystrayBox *box,
       box->size_alloc = size_alloc;
 
       if (box->childeren != NULL)
-        gtk_widget_queue_resize (GTK_WIDGET (box));
+        systray_box_layout_invalidate (box);
     }
 }
 
@@ -753,7 +1011,7 @@ systray_box_set_show_hidden (SystrayBox *box,
       box->show_hidden = show_hidden;
 
       if (box->childeren != NULL)
-        gtk_widget_queue_resize (GTK_WIDGET (box));
+        systray_box_layout_invalidate (box);
     }
 }
 
@@ -778,5 +1036,5 @@ systray_box_update (SystrayBox *box)
                                  systray_box_compare_function);
 
   /* update the box, so we update the has-hidden property */
-  gtk_widget_queue_resize (GTK_WIDGET (box));
+  systray_box_layout_invalidate (box);
 }
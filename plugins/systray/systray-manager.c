@@ -54,6 +54,15 @@
 #define XFCE_SYSTRAY_MANAGER_ORIENTATION_HORIZONTAL 0
 #define XFCE_SYSTRAY_MANAGER_ORIENTATION_VERTICAL   1
 
+/* limits for pending balloon messages, so a misbehaving client
+ * cannot make us allocate without bounds */
+#define XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_LENGTH  (64 * 1024)
+#define XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_PENDING (32)
+#define XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_AGE     (30) /* seconds */
+
+/* number of queued dock requests handled in one idle iteration */
+#define XFCE_SYSTRAY_MANAGER_DOCK_BATCH (4)
+
 
 
 static void            systray_manager_finalize                           (GObject             *object);
@@ -75,12 +84,15 @@ static void            systray_manager_handle_cancel_message              (Systr
                                                                            XClientMessageEvent *xevent);
 static void            systray_manager_handle_dock_request                (SystrayManager      *manager,
                                                                            XClientMessageEvent *xevent);
+static void            systray_manager_dock_queue_clear                   (SystrayManager      *manager);
 static gboolean        systray_manager_handle_undock_request              (GtkSocket           *socket,
                                                                            gpointer             user_data);
 static void            systray_manager_set_visual                         (SystrayManager      *manager);
 static void            systray_manager_message_free                       (SystrayMessage      *message);
-static void            systray_manager_message_remove_from_list           (SystrayManager      *manager,
-                                                                           XClientMessageEvent *xevent);
+static void            systray_manager_message_remove                     (SystrayManager      *manager,
+                                                                           Window               window,
+                                                                           glong                id);
+static void            systray_manager_message_expire                     (SystrayManager      *manager);
 
 
 
@@ -112,8 +124,12 @@ struct _SystrayManager
   /* orientation of the tray */
   GtkOrientation  orientation;
 
-  /* list of pending messages */
-  GSList         *messages;
+  /* pending messages, indexed by the icon window */
+  GHashTable     *messages;
+
+  /* dock requests waiting to be embedded */
+  GQueue         *dock_queue;
+  guint           dock_idle_id;
 
   /* _net_system_tray_opcode atom */
   Atom            opcode_atom;
@@ -137,8 +153,21 @@ struct _SystrayMessage
   glong           length;
   glong           remaining_length;
   glong           timeout;
+
+  /* time the message was started, in seconds */
+  glong           started;
 };
 
+typedef struct
+{
+  /* client window of the tray icon */
+  GdkNativeWindow window;
+
+  /* time of the request */
+  GTimeVal        requested;
+}
+SystrayDockRequest;
+
 
 
 static guint  systray_manager_signals[LAST_SIGNAL];
@@ -213,8 +242,11 @@ systray_manager_init (SystrayManager *manager)
 {
   manager->invisible = NULL;
   manager->orientation = GTK_ORIENTATION_HORIZONTAL;
-  manager->messages = NULL;
   manager->sockets = g_hash_table_new (NULL, NULL);
+  manager->messages = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) systray_manager_message_free);
+  manager->dock_queue = g_queue_new ();
+  manager->dock_idle_id = 0;
 }
 
 
@@ -242,15 +274,11 @@ systray_manager_finalize (GObject *object)
   /* destroy the hash table */
   g_hash_table_destroy (manager->sockets);
 
-  if (manager->messages)
-    {
-      /* cleanup all pending messages */
-      g_slist_foreach (manager->messages,
-                       (GFunc) systray_manager_message_free, NULL);
+  /* cleanup all pending messages */
+  g_hash_table_destroy (manager->messages);
 
-      /* free the list */
-      g_slist_free (manager->messages);
-    }
+  systray_manager_dock_queue_clear (manager);
+  g_queue_free (manager->dock_queue);
 
   G_OBJECT_CLASS (systray_manager_parent_class)->finalize (object);
 }
@@ -461,6 +489,9 @@ systray_manager_unregister (SystrayManager *manager)
   gdk_window_remove_filter (invisible->window,
       systray_manager_window_filter, manager);
 
+  /* drop icons that are not docked yet */
+  systray_manager_dock_queue_clear (manager);
+
   /* remove all sockets from the hash table */
   g_hash_table_foreach (manager->sockets,
       systray_manager_remove_socket, manager);
@@ -553,48 +584,37 @@ systray_manager_handle_client_message_message_data (GdkXEvent *xevent,
 {
   XClientMessageEvent *xev = xevent;
   SystrayManager      *manager = XFCE_SYSTRAY_MANAGER (user_data);
-  GSList              *li;
   SystrayMessage      *message;
   glong                length;
   GtkSocket           *socket;
 
   panel_return_val_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager), GDK_FILTER_REMOVE);
 
-  /* try to find the pending message in the list */
-  for (li = manager->messages; li != NULL; li = li->next)
+  /* lookup the pending message of this window */
+  message = g_hash_table_lookup (manager->messages, GUINT_TO_POINTER (xev->window));
+  if (G_UNLIKELY (message == NULL))
+    return GDK_FILTER_REMOVE;
+
+  /* copy the data of this message */
+  length = MIN (message->remaining_length, 20);
+  memcpy ((message->string + message->length - message->remaining_length), &xev->data, length);
+  message->remaining_length -= length;
+
+  /* check if we have the complete message */
+  if (message->remaining_length == 0)
     {
-      message = li->data;
+      /* try to get the socket from the known tray icons */
+      socket = g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (message->window));
 
-      if (xev->window == message->window)
+      if (G_LIKELY (socket))
         {
-          /* copy the data of this message */
-          length = MIN (message->remaining_length, 20);
-          memcpy ((message->string + message->length - message->remaining_length), &xev->data, length);
-          message->remaining_length -= length;
-
-          /* check if we have the complete message */
-          if (message->remaining_length == 0)
-            {
-              /* try to get the socket from the known tray icons */
-              socket = g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (message->window));
-
-              if (G_LIKELY (socket))
-                {
-                  /* known socket, send the signal */
-                  g_signal_emit (manager, systray_manager_signals[MESSAGE_SENT], 0,
-                                 socket, message->string, message->id, message->timeout);
-                }
-
-              /* delete the message from the list */
-              manager->messages = g_slist_delete_link (manager->messages, li);
-
-              /* free the message */
-              systray_manager_message_free (message);
-            }
-
-          /* stop searching */
-          break;
+          /* known socket, send the signal */
+          g_signal_emit (manager, systray_manager_signals[MESSAGE_SENT], 0,
+                         socket, message->string, message->id, message->timeout);
         }
+
+      /* delete and free the message */
+      g_hash_table_remove (manager->messages, GUINT_TO_POINTER (xev->window));
     }
 
   return GDK_FILTER_REMOVE;
@@ -609,6 +629,7 @@ systray_manager_handle_begin_message (SystrayManager      *manager,
   GtkSocket      *socket;
   SystrayMessage *message;
   glong           length, timeout, id;
+  GTimeVal        now;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
 
@@ -619,8 +640,9 @@ systray_manager_handle_begin_message (SystrayManager      *manager,
   if (G_UNLIKELY (socket == NULL))
     return;
 
-  /* remove the same message from the list */
-  systray_manager_message_remove_from_list (manager, xevent);
+  /* data is always appended to the last started message of a window, so
+   * a new message replaces the pending message of the same window */
+  g_hash_table_remove (manager->messages, GUINT_TO_POINTER (xevent->window));
 
   /* get some message information */
   timeout = xevent->data.l[2];
@@ -633,8 +655,20 @@ systray_manager_handle_begin_message (SystrayManager      *manager,
       g_signal_emit (manager, systray_manager_signals[MESSAGE_SENT], 0,
                      socket, "", id, timeout);
     }
+  else if (length < 0
+           || length > XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_LENGTH)
+    {
+      panel_debug (PANEL_DEBUG_SYSTRAY,
+                   "ignored message of %ld bytes from %s[%p]", length,
+                   systray_socket_get_name (XFCE_SYSTRAY_SOCKET (socket)), socket);
+    }
   else
     {
+      /* drop old and incomplete messages before adding a new one */
+      systray_manager_message_expire (manager);
+
+      g_get_current_time (&now);
+
       /* create new structure */
       message = g_slice_new0 (SystrayMessage);
 
@@ -644,11 +678,15 @@ systray_manager_handle_begin_message (SystrayManager      *manager,
       message->length           = length;
       message->id               = id;
       message->remaining_length = length;
+      message->started          = now.tv_sec;
+
+      /* allocate the buffer for the complete message */
       message->string           = g_malloc (length + 1);
       message->string[length]   = '\0';
 
-      /* add this message to the list of pending messages */
-      manager->messages = g_slist_prepend (manager->messages, message);
+      /* add this message to the pending messages */
+      g_hash_table_insert (manager->messages,
+                           GUINT_TO_POINTER (message->window), message);
     }
 }
 
@@ -663,8 +701,8 @@ systray_manager_handle_cancel_message (SystrayManager      *manager,
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
 
-  /* remove the same message from the list */
-  systray_manager_message_remove_from_list (manager, xevent);
+  /* remove the same message from the pending messages */
+  systray_manager_message_remove (manager, xevent->window, xevent->data.l[2]);
 
   /* try to find the window in the list of known tray icons */
   socket = g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (xevent->window));
@@ -677,13 +715,27 @@ systray_manager_handle_cancel_message (SystrayManager      *manager,
 
 
 
+static glong
+systray_manager_elapsed_ms (const GTimeVal *start)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+
+  return (now.tv_sec - start->tv_sec) * 1000
+         + (now.tv_usec - start->tv_usec) / 1000;
+}
+
+
+
 static void
-systray_manager_handle_dock_request (SystrayManager      *manager,
-                                     XClientMessageEvent *xevent)
+systray_manager_dock (SystrayManager     *manager,
+                      SystrayDockRequest *request)
 {
   GtkWidget       *socket;
   GdkScreen       *screen;
-  GdkNativeWindow  window = xevent->data.l[2];
+  GdkNativeWindow  window = request->window;
+  glong            waited;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
   panel_return_if_fail (GTK_IS_INVISIBLE (manager->invisible));
@@ -692,11 +744,20 @@ systray_manager_handle_dock_request (SystrayManager      *manager,
   if (g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (window)) != NULL)
     return;
 
-  /* create the socket */
+  waited = systray_manager_elapsed_ms (&request->requested);
+
+  /* create the socket, this also validates the window */
   screen = gtk_widget_get_screen (manager->invisible);
   socket = systray_socket_new (screen, window);
   if (G_UNLIKELY (socket == NULL))
-    return;
+    {
+      panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+          "window 0x%lx disappeared before docking", (gulong) window);
+      return;
+    }
+
+  /* fetch the name before the icon is sorted in the box */
+  systray_socket_get_name (XFCE_SYSTRAY_SOCKET (socket));
 
   /* add the icon to the tray */
   g_signal_emit (manager, systray_manager_signals[ICON_ADDED], 0, socket);
@@ -709,11 +770,30 @@ systray_manager_handle_dock_request (SystrayManager      *manager,
       g_signal_connect (G_OBJECT (socket), "plug-removed",
           G_CALLBACK (systray_manager_handle_undock_request), manager);
 
-      /* register the xembed client window id for this socket */
+      /* register the xembed client window id for this socket, this
+       * reparents the window and does not wait for the client */
       gtk_socket_add_id (GTK_SOCKET (socket), window);
 
-      /* add the socket to the list of known sockets */
-      g_hash_table_insert (manager->sockets, GUINT_TO_POINTER (window), socket);
+      if (G_LIKELY (GTK_SOCKET (socket)->plug_window != NULL))
+        {
+          /* add the socket to the list of known sockets */
+          g_hash_table_insert (manager->sockets, GUINT_TO_POINTER (window), socket);
+
+          panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+              "docked %s[%p] in %ld ms (queued %ld ms)",
+              systray_socket_get_name (XFCE_SYSTRAY_SOCKET (socket)), socket,
+              systray_manager_elapsed_ms (&request->requested), waited);
+        }
+      else
+        {
+          /* the window was destroyed while embedding */
+          panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+              "failed to embed window 0x%lx", (gulong) window);
+
+          g_signal_handlers_disconnect_by_func (G_OBJECT (socket),
+              systray_manager_handle_undock_request, manager);
+          g_signal_emit (manager, systray_manager_signals[ICON_REMOVED], 0, socket);
+        }
     }
   else
     {
@@ -727,6 +807,94 @@ systray_manager_handle_dock_request (SystrayManager      *manager,
 
 
 
+static gboolean
+systray_manager_dock_idle (gpointer user_data)
+{
+  SystrayManager     *manager = XFCE_SYSTRAY_MANAGER (user_data);
+  SystrayDockRequest *request;
+  guint               n;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager), FALSE);
+
+  GDK_THREADS_ENTER ();
+
+  /* embed a limited number of icons per iteration, so a burst of
+   * icons at login does not block the main loop */
+  for (n = 0; n < XFCE_SYSTRAY_MANAGER_DOCK_BATCH; n++)
+    {
+      request = g_queue_pop_head (manager->dock_queue);
+      if (request == NULL)
+        break;
+
+      if (G_LIKELY (manager->invisible != NULL))
+        systray_manager_dock (manager, request);
+
+      g_slice_free (SystrayDockRequest, request);
+    }
+
+  GDK_THREADS_LEAVE ();
+
+  return !g_queue_is_empty (manager->dock_queue);
+}
+
+
+
+static void
+systray_manager_dock_idle_destroyed (gpointer user_data)
+{
+  XFCE_SYSTRAY_MANAGER (user_data)->dock_idle_id = 0;
+}
+
+
+
+static void
+systray_manager_dock_queue_clear (SystrayManager *manager)
+{
+  SystrayDockRequest *request;
+
+  if (manager->dock_idle_id != 0)
+    g_source_remove (manager->dock_idle_id);
+
+  while ((request = g_queue_pop_head (manager->dock_queue)) != NULL)
+    g_slice_free (SystrayDockRequest, request);
+}
+
+
+
+static void
+systray_manager_handle_dock_request (SystrayManager      *manager,
+                                     XClientMessageEvent *xevent)
+{
+  SystrayDockRequest *request;
+  GdkNativeWindow     window = xevent->data.l[2];
+  GList              *li;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
+  panel_return_if_fail (GTK_IS_INVISIBLE (manager->invisible));
+
+  /* check if we already have this window */
+  if (g_hash_table_lookup (manager->sockets, GUINT_TO_POINTER (window)) != NULL)
+    return;
+
+  /* check if the window is already queued */
+  for (li = manager->dock_queue->head; li != NULL; li = li->next)
+    if (((SystrayDockRequest *) li->data)->window == window)
+      return;
+
+  /* queue the request, the icon is embedded from an idle
+   * callback so we return to the event loop as soon as possible */
+  request = g_slice_new0 (SystrayDockRequest);
+  request->window = window;
+  g_get_current_time (&request->requested);
+  g_queue_push_tail (manager->dock_queue, request);
+
+  if (manager->dock_idle_id == 0)
+    manager->dock_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, systray_manager_dock_idle,
+                                             manager, systray_manager_dock_idle_destroyed);
+}
+
+
+
 static gboolean
 systray_manager_handle_undock_request (GtkSocket *socket,
                                        gpointer   user_data)
@@ -847,29 +1015,81 @@ systray_manager_message_free (SystrayMessage *message)
 
 
 static void
-systray_manager_message_remove_from_list (SystrayManager      *manager,
-                                          XClientMessageEvent *xevent)
+systray_manager_message_remove (SystrayManager *manager,
+                                Window          window,
+                                glong           id)
 {
-  GSList         *li;
   SystrayMessage *message;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
 
-  /* seach for the same message in the list of pending messages */
-  for (li = manager->messages; li != NULL; li = li->next)
-    {
-      message = li->data;
+  /* check if this is the same message */
+  message = g_hash_table_lookup (manager->messages, GUINT_TO_POINTER (window));
+  if (message != NULL && message->id == id)
+    g_hash_table_remove (manager->messages, GUINT_TO_POINTER (window));
+}
 
-      /* check if this is the same message */
-      if (xevent->window == message->window && xevent->data.l[4] == message->id)
-        {
-          /* delete the message from the list */
-          manager->messages = g_slist_delete_link (manager->messages, li);
 
-          /* free the message */
-          systray_manager_message_free (message);
 
-          break;
-        }
+static gboolean
+systray_manager_message_expire_func (gpointer key,
+                                     gpointer value,
+                                     gpointer user_data)
+{
+  SystrayMessage *message = value;
+  glong           now = *(glong *) user_data;
+
+  return now - message->started > XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_AGE;
+}
+
+
+
+static void
+systray_manager_message_find_oldest (gpointer key,
+                                     gpointer value,
+                                     gpointer user_data)
+{
+  SystrayMessage  *message = value;
+  SystrayMessage **oldest = user_data;
+
+  if (*oldest == NULL || message->started < (*oldest)->started)
+    *oldest = message;
+}
+
+
+
+static void
+systray_manager_message_expire (SystrayManager *manager)
+{
+  GTimeVal        now;
+  glong           now_sec;
+  guint           n_expired;
+  SystrayMessage *oldest = NULL;
+
+  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
+
+  if (g_hash_table_size (manager->messages) == 0)
+    return;
+
+  /* remove messages that never completed */
+  g_get_current_time (&now);
+  now_sec = now.tv_sec;
+  n_expired = g_hash_table_foreach_remove (manager->messages,
+      systray_manager_message_expire_func, &now_sec);
+
+  if (G_UNLIKELY (n_expired > 0))
+    panel_debug (PANEL_DEBUG_SYSTRAY, "expired %u pending messages", n_expired);
+
+  /* evict the oldest message if we reached the maximum */
+  if (g_hash_table_size (manager->messages) >= XFCE_SYSTRAY_MANAGER_MESSAGE_MAX_PENDING)
+    {
+      g_hash_table_foreach (manager->messages,
+          systray_manager_message_find_oldest, &oldest);
+      panel_assert (oldest != NULL);
+
+      panel_debug (PANEL_DEBUG_SYSTRAY, "evicted pending message %ld of window 0x%lx",
+                   oldest->id, (gulong) oldest->window);
+
+      g_hash_table_remove (manager->messages, GUINT_TO_POINTER (oldest->window));
     }
 }
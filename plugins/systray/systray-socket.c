@@ -29,6 +29,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
@@ -56,6 +57,10 @@ struct _SystraySocket
   GdkNativeWindow window;
 
   gchar           *name;
+  gchar           *wm_class;
+
+  /* plug window we monitor for name changes */
+  GdkWindow       *filter_window;
 
   guint            is_composited : 1;
   guint            parent_relative_bg : 1;
@@ -72,6 +77,21 @@ static gboolean systray_socket_expose_event  (GtkWidget      *widget,
                                               GdkEventExpose *event);
 static void     systray_socket_style_set     (GtkWidget      *widget,
                                               GtkStyle       *previous_style);
+static void     systray_socket_unrealize     (GtkWidget      *widget);
+static void     systray_socket_plug_added    (GtkSocket      *gtk_socket);
+static void     systray_socket_filter_remove (SystraySocket  *socket);
+
+
+
+enum
+{
+  NAME_CHANGED,
+  LAST_SIGNAL
+};
+
+
+
+static guint systray_socket_signals[LAST_SIGNAL];
 
 
 
@@ -84,6 +104,7 @@ systray_socket_class_init (SystraySocketClass *klass)
 {
   GtkWidgetClass *gtkwidget_class;
   GObjectClass   *gobject_class;
+  GtkSocketClass *gtksocket_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = systray_socket_finalize;
@@ -93,6 +114,18 @@ systray_socket_class_init (SystraySocketClass *klass)
   gtkwidget_class->size_allocate = systray_socket_size_allocate;
   gtkwidget_class->expose_event = systray_socket_expose_event;
   gtkwidget_class->style_set = systray_socket_style_set;
+  gtkwidget_class->unrealize = systray_socket_unrealize;
+
+  gtksocket_class = GTK_SOCKET_CLASS (klass);
+  gtksocket_class->plug_added = systray_socket_plug_added;
+
+  systray_socket_signals[NAME_CHANGED] =
+      g_signal_new (g_intern_static_string ("name-changed"),
+                    G_OBJECT_CLASS_TYPE (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0, NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
 }
 
 
@@ -102,6 +135,8 @@ systray_socket_init (SystraySocket *socket)
 {
   socket->hidden = FALSE;
   socket->name = NULL;
+  socket->wm_class = NULL;
+  socket->filter_window = NULL;
 }
 
 
@@ -111,7 +146,10 @@ systray_socket_finalize (GObject *object)
 {
   SystraySocket *socket = XFCE_SYSTRAY_SOCKET (object);
 
+  systray_socket_filter_remove (socket);
+
   g_free (socket->name);
+  g_free (socket->wm_class);
 
   G_OBJECT_CLASS (systray_socket_parent_class)->finalize (object);
 }
@@ -237,6 +275,92 @@ systray_socket_style_set (GtkWidget *widget,
 
 
 
+static void
+systray_socket_unrealize (GtkWidget *widget)
+{
+  /* stop monitoring before gtk releases the plug window */
+  systray_socket_filter_remove (XFCE_SYSTRAY_SOCKET (widget));
+
+  (*GTK_WIDGET_CLASS (systray_socket_parent_class)->unrealize) (widget);
+}
+
+
+
+static GdkFilterReturn
+systray_socket_filter (GdkXEvent *gdk_xevent,
+                       GdkEvent  *event,
+                       gpointer   user_data)
+{
+  XEvent        *xevent = gdk_xevent;
+  SystraySocket *socket = XFCE_SYSTRAY_SOCKET (user_data);
+  GdkDisplay    *display;
+  Atom           atom;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SOCKET (socket), GDK_FILTER_CONTINUE);
+
+  if (xevent->type == PropertyNotify
+      && xevent->xproperty.window == socket->window)
+    {
+      display = gtk_widget_get_display (GTK_WIDGET (socket));
+      atom = xevent->xproperty.atom;
+
+      if (atom == XA_WM_NAME
+          || atom == XA_WM_CLASS
+          || atom == gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_NAME"))
+        {
+          /* drop the cached names, they are fetched on the next request */
+          g_free (socket->name);
+          socket->name = NULL;
+          g_free (socket->wm_class);
+          socket->wm_class = NULL;
+
+          panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+              "name of socket %s[%p] changed",
+              systray_socket_get_name (socket), socket);
+
+          g_signal_emit (G_OBJECT (socket),
+                         systray_socket_signals[NAME_CHANGED], 0);
+        }
+    }
+
+  return GDK_FILTER_CONTINUE;
+}
+
+
+
+static void
+systray_socket_plug_added (GtkSocket *gtk_socket)
+{
+  SystraySocket *socket = XFCE_SYSTRAY_SOCKET (gtk_socket);
+
+  /* gtk already selects property changes on the plug window, so we
+   * only have to add a filter to see name changes of the icon */
+  if (socket->filter_window == NULL
+      && gtk_socket->plug_window != NULL)
+    {
+      socket->filter_window = g_object_ref (G_OBJECT (gtk_socket->plug_window));
+      gdk_window_add_filter (socket->filter_window, systray_socket_filter, socket);
+    }
+
+  if (GTK_SOCKET_CLASS (systray_socket_parent_class)->plug_added != NULL)
+    (*GTK_SOCKET_CLASS (systray_socket_parent_class)->plug_added) (gtk_socket);
+}
+
+
+
+static void
+systray_socket_filter_remove (SystraySocket *socket)
+{
+  if (socket->filter_window != NULL)
+    {
+      gdk_window_remove_filter (socket->filter_window, systray_socket_filter, socket);
+      g_object_unref (G_OBJECT (socket->filter_window));
+      socket->filter_window = NULL;
+    }
+}
+
+
+
 GtkWidget *
 systray_socket_new (GdkScreen       *screen,
                     GdkNativeWindow  window)
@@ -421,6 +545,42 @@ systray_socket_get_name (SystraySocket *socket)
 
 
 
+const gchar *
+systray_socket_get_class (SystraySocket *socket)
+{
+  GdkDisplay *display;
+  XClassHint  hint;
+  gint        result;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SOCKET (socket), NULL);
+
+  if (G_LIKELY (socket->wm_class != NULL))
+    return socket->wm_class;
+
+  display = gtk_widget_get_display (GTK_WIDGET (socket));
+
+  hint.res_name = hint.res_class = NULL;
+
+  gdk_error_trap_push ();
+  result = XGetClassHint (GDK_DISPLAY_XDISPLAY (display), socket->window, &hint);
+  if (gdk_error_trap_pop () == 0 && result != 0)
+    {
+      /* lowercase the result, like the name */
+      if (hint.res_class != NULL
+          && g_utf8_validate (hint.res_class, -1, NULL))
+        socket->wm_class = g_utf8_strdown (hint.res_class, -1);
+    }
+
+  if (hint.res_name != NULL)
+    XFree (hint.res_name);
+  if (hint.res_class != NULL)
+    XFree (hint.res_class);
+
+  return socket->wm_class;
+}
+
+
+
 GdkNativeWindow *
 systray_socket_get_window (SystraySocket *socket)
 {
@@ -47,6 +47,8 @@ gboolean         systray_socket_is_composited (SystraySocket   *socket);
 
 const gchar     *systray_socket_get_name      (SystraySocket   *socket);
 
+const gchar     *systray_socket_get_class     (SystraySocket   *socket);
+
 GdkNativeWindow *systray_socket_get_window    (SystraySocket   *socket);
 
 gboolean         systray_socket_get_hidden    (SystraySocket   *socket);
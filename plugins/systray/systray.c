@@ -21,6 +21,10 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4ui/libxfce4ui.h>
 #include <common/panel-private.h>
@@ -40,6 +44,30 @@
 #define FRAME_SPACING (1)
 
 
+
+typedef enum
+{
+  RULE_MATCH_NAME,
+  RULE_MATCH_CLASS
+}
+SystrayRuleMatch;
+
+typedef struct
+{
+  /* the pattern as stored in the settings */
+  gchar            *pattern;
+
+  /* property of the icon we match */
+  SystrayRuleMatch  match;
+
+  /* compiled glob or regular expression */
+  GPatternSpec     *spec;
+  GRegex           *regex;
+}
+SystrayRule;
+
+
+
 static void     systray_plugin_get_property                 (GObject               *object,
                                                              guint                  prop_id,
                                                              GValue                *value,
@@ -60,6 +88,9 @@ static void     systray_plugin_box_expose_event             (GtkWidget
 static void     systray_plugin_button_toggled               (GtkWidget             *button,
                                                              SystrayPlugin         *plugin);
 static void     systray_plugin_button_set_arrow             (SystrayPlugin         *plugin);
+static void     systray_plugin_names_collect                (GPtrArray             *array,
+                                                             const gchar           *name);
+static SystrayRule *systray_plugin_rule_new                 (const gchar           *pattern);
 static void     systray_plugin_names_collect_visible        (gpointer               key,
                                                              gpointer               value,
                                                              gpointer               user_data);
@@ -72,9 +103,14 @@ static gboolean systray_plugin_names_remove                 (gpointer
 static void     systray_plugin_names_update                 (SystrayPlugin         *plugin);
 static gboolean systray_plugin_names_get_hidden             (SystrayPlugin         *plugin,
                                                              const gchar           *name);
+static void     systray_plugin_rules_free                   (SystrayPlugin         *plugin);
+static gboolean systray_plugin_rules_get_hidden             (SystrayPlugin         *plugin,
+                                                             SystraySocket         *socket);
 static void     systray_plugin_icon_added                   (SystrayManager        *manager,
                                                              GtkWidget             *icon,
                                                              SystrayPlugin         *plugin);
+static void     systray_plugin_icon_name_changed            (GtkWidget             *icon,
+                                                             SystrayPlugin         *plugin);
 static void     systray_plugin_icon_removed                 (SystrayManager        *manager,
                                                              GtkWidget             *icon,
                                                              SystrayPlugin         *plugin);
@@ -114,15 +150,28 @@ struct _SystrayPlugin
   /* settings */
   guint           show_frame : 1;
   GHashTable     *names;
+
+  /* compiled hidden-patterns (SystrayRule) */
+  GSList         *rules;
 };
 
+typedef struct
+{
+  GdkWindow *window;
+  GdkRegion *region;
+  cairo_t   *cr;
+  gint       n_painted;
+}
+SystrayPluginExpose;
+
 enum
 {
   PROP_0,
   PROP_SIZE_MAX,
   PROP_SHOW_FRAME,
   PROP_NAMES_HIDDEN,
-  PROP_NAMES_VISIBLE
+  PROP_NAMES_VISIBLE,
+  PROP_HIDDEN_PATTERNS
 };
 
 enum
@@ -204,6 +253,13 @@ systray_plugin_class_init (SystrayPluginClass *klass)
                                                        NULL, NULL,
                                                        PANEL_PROPERTIES_TYPE_VALUE_ARRAY,
                                                        EXO_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class,
+                                   PROP_HIDDEN_PATTERNS,
+                                   g_param_spec_boxed ("hidden-patterns",
+                                                       NULL, NULL,
+                                                       PANEL_PROPERTIES_TYPE_VALUE_ARRAY,
+                                                       EXO_PARAM_READWRITE));
 }
 
 
@@ -217,6 +273,7 @@ systray_plugin_init (SystrayPlugin *plugin)
   plugin->show_frame = TRUE;
   plugin->idle_startup = 0;
   plugin->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  plugin->rules = NULL;
 
   plugin->frame = gtk_frame_new (NULL);
   gtk_container_add (GTK_CONTAINER (plugin), plugin->frame);
@@ -258,6 +315,7 @@ systray_plugin_get_property (GObject    *object,
 {
   SystrayPlugin *plugin = XFCE_SYSTRAY_PLUGIN (object);
   GPtrArray     *array;
+  GSList        *li;
 
   switch (prop_id)
     {
@@ -284,6 +342,14 @@ systray_plugin_get_property (GObject    *object,
       xfconf_array_free (array);
       break;
 
+    case PROP_HIDDEN_PATTERNS:
+      array = g_ptr_array_new ();
+      for (li = plugin->rules; li != NULL; li = li->next)
+        systray_plugin_names_collect (array, ((SystrayRule *) li->data)->pattern);
+      g_value_set_boxed (value, array);
+      xfconf_array_free (array);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -306,6 +372,7 @@ systray_plugin_set_property (GObject      *object,
   gchar         *name;
   guint          i;
   GtkRcStyle    *style;
+  SystrayRule   *rule;
 
   switch (prop_id)
     {
@@ -359,6 +426,30 @@ systray_plugin_set_property (GObject      *object,
       systray_plugin_names_update (plugin);
       break;
 
+    case PROP_HIDDEN_PATTERNS:
+      systray_plugin_rules_free (plugin);
+
+      /* compile the patterns once, icons are matched against
+       * the rules when they dock or change their name */
+      array = g_value_get_boxed (value);
+      if (G_LIKELY (array != NULL))
+        {
+          for (i = 0; i < array->len; i++)
+            {
+              tmp = g_ptr_array_index (array, i);
+              panel_assert (G_VALUE_HOLDS_STRING (tmp));
+              rule = systray_plugin_rule_new (g_value_get_string (tmp));
+              if (G_LIKELY (rule != NULL))
+                plugin->rules = g_slist_prepend (plugin->rules, rule);
+            }
+
+          plugin->rules = g_slist_reverse (plugin->rules);
+        }
+
+      /* update icons in the box */
+      systray_plugin_names_update (plugin);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -454,6 +545,7 @@ systray_plugin_construct (XfcePanelPlugin *panel_plugin)
     { "show-frame", G_TYPE_BOOLEAN },
     { "names-visible", PANEL_PROPERTIES_TYPE_VALUE_ARRAY },
     { "names-hidden", PANEL_PROPERTIES_TYPE_VALUE_ARRAY },
+    { "hidden-patterns", PANEL_PROPERTIES_TYPE_VALUE_ARRAY },
     { NULL }
   };
 
@@ -489,6 +581,7 @@ systray_plugin_free_data (XfcePanelPlugin *panel_plugin)
       systray_plugin_screen_changed, NULL);
 
   g_hash_table_destroy (plugin->names);
+  systray_plugin_rules_free (plugin);
 
   if (G_LIKELY (plugin->manager != NULL))
     {
@@ -595,20 +688,45 @@ static void
 systray_plugin_box_expose_event_icon (GtkWidget *child,
                                       gpointer   user_data)
 {
-  cairo_t       *cr = user_data;
-  GtkAllocation *alloc;
+  SystrayPluginExpose *expose = user_data;
+  GtkAllocation       *alloc;
 
   if (systray_socket_is_composited (XFCE_SYSTRAY_SOCKET (child)))
     {
       alloc = &child->allocation;
 
       /* skip hidden (see offscreen in box widget) icons */
-      if (alloc->x > -1 && alloc->y > -1)
+      if (alloc->x < 0 || alloc->y < 0)
+        return;
+
+      /* skip icons outside the damaged region, gdk already tracks
+       * damage on the composited child windows and only invalidates
+       * the area of the icon that changed */
+      if (gdk_region_rect_in (expose->region, alloc) == GDK_OVERLAP_RECTANGLE_OUT)
+        return;
+
+      if (expose->cr == NULL)
         {
-          gdk_cairo_set_source_pixmap (cr, gtk_widget_get_window (child),
-                                       alloc->x, alloc->y);
-          cairo_paint (cr);
+          expose->cr = gdk_cairo_create (expose->window);
+          if (G_UNLIKELY (expose->cr == NULL))
+            return;
+
+          gdk_cairo_region (expose->cr, expose->region);
+          cairo_clip (expose->cr);
         }
+
+      cairo_save (expose->cr);
+
+      gdk_cairo_rectangle (expose->cr, alloc);
+      cairo_clip (expose->cr);
+
+      gdk_cairo_set_source_pixmap (expose->cr, gtk_widget_get_window (child),
+                                   alloc->x, alloc->y);
+      cairo_paint (expose->cr);
+
+      cairo_restore (expose->cr);
+
+      expose->n_painted++;
     }
 }
 
@@ -618,23 +736,29 @@ static void
 systray_plugin_box_expose_event (GtkWidget      *box,
                                  GdkEventExpose *event)
 {
-  cairo_t *cr;
+  SystrayPluginExpose expose;
 
   if (!gtk_widget_is_composited (box))
     return;
 
-  cr = gdk_cairo_create (gtk_widget_get_window (box));
-  if (G_LIKELY (cr != NULL))
-    {
-      gdk_cairo_rectangle (cr, &event->area);
-      cairo_clip (cr);
+  expose.window = gtk_widget_get_window (box);
+  expose.region = event->region;
+  expose.cr = NULL;
+  expose.n_painted = 0;
+
+  /* separately draw the composed tray icons in the damaged region
+   * after gtk handled the expose event, the cairo context is only
+   * created if there is an icon to paint */
+  gtk_container_foreach (GTK_CONTAINER (box),
+      systray_plugin_box_expose_event_icon, &expose);
 
-      /* separately draw all the composed tray icons after gtk
-       * handled the expose event */
-      gtk_container_foreach (GTK_CONTAINER (box),
-          systray_plugin_box_expose_event_icon, cr);
+  if (expose.cr != NULL)
+    {
+      cairo_destroy (expose.cr);
 
-      cairo_destroy (cr);
+      panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+          "repainted %d composited icons in (%d,%d;%d,%d)", expose.n_painted,
+          event->area.x, event->area.y, event->area.width, event->area.height);
     }
 }
 
@@ -731,13 +855,20 @@ systray_plugin_names_update_icon (GtkWidget *icon,
   SystrayPlugin *plugin = XFCE_SYSTRAY_PLUGIN (data);
   SystraySocket *socket = XFCE_SYSTRAY_SOCKET (icon);
   const gchar   *name;
+  gboolean       hidden;
 
   panel_return_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin));
   panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (icon));
 
+  /* always lookup the name, so it is known in the dialog */
   name = systray_socket_get_name (socket);
-  systray_socket_set_hidden (socket,
-      systray_plugin_names_get_hidden (plugin, name));
+  hidden = systray_plugin_names_get_hidden (plugin, name);
+
+  /* check the admin patterns if the name is not hidden */
+  if (!hidden && plugin->rules != NULL)
+    hidden = systray_plugin_rules_get_hidden (plugin, socket);
+
+  systray_socket_set_hidden (socket, hidden);
 }
 
 
@@ -801,6 +932,138 @@ systray_plugin_names_get_hidden (SystrayPlugin *plugin,
 
 
 
+static SystrayRule *
+systray_plugin_rule_new (const gchar *pattern)
+{
+  SystrayRule *rule;
+  const gchar *p = pattern;
+  gsize        len;
+  gchar       *tmp;
+  GError      *error = NULL;
+
+  if (exo_str_is_empty (pattern))
+    return NULL;
+
+  rule = g_slice_new0 (SystrayRule);
+  rule->pattern = g_strdup (pattern);
+  rule->match = RULE_MATCH_NAME;
+
+  /* patterns are "[name:|class:]glob" or "[name:|class:]/regex/" and
+   * match the lowercased _NET_WM_NAME or the WM_CLASS of the icon */
+  if (g_str_has_prefix (p, "class:"))
+    {
+      rule->match = RULE_MATCH_CLASS;
+      p += strlen ("class:");
+    }
+  else if (g_str_has_prefix (p, "name:"))
+    {
+      p += strlen ("name:");
+    }
+
+  len = strlen (p);
+  if (len > 2 && p[0] == '/' && p[len - 1] == '/')
+    {
+      tmp = g_strndup (p + 1, len - 2);
+      rule->regex = g_regex_new (tmp, G_REGEX_CASELESS | G_REGEX_OPTIMIZE, 0, &error);
+      g_free (tmp);
+
+      if (G_UNLIKELY (rule->regex == NULL))
+        {
+          g_warning ("Failed to compile systray pattern \"%s\": %s",
+                     pattern, error->message);
+          g_error_free (error);
+
+          g_free (rule->pattern);
+          g_slice_free (SystrayRule, rule);
+
+          return NULL;
+        }
+    }
+  else if (*p != '\0')
+    {
+      tmp = g_utf8_strdown (p, -1);
+      rule->spec = g_pattern_spec_new (tmp);
+      g_free (tmp);
+    }
+  else
+    {
+      g_free (rule->pattern);
+      g_slice_free (SystrayRule, rule);
+
+      return NULL;
+    }
+
+  return rule;
+}
+
+
+
+static void
+systray_plugin_rule_free (gpointer data)
+{
+  SystrayRule *rule = data;
+
+  if (rule->spec != NULL)
+    g_pattern_spec_free (rule->spec);
+  if (rule->regex != NULL)
+    g_regex_unref (rule->regex);
+
+  g_free (rule->pattern);
+  g_slice_free (SystrayRule, rule);
+}
+
+
+
+static void
+systray_plugin_rules_free (SystrayPlugin *plugin)
+{
+  g_slist_foreach (plugin->rules, (GFunc) systray_plugin_rule_free, NULL);
+  g_slist_free (plugin->rules);
+  plugin->rules = NULL;
+}
+
+
+
+static gboolean
+systray_plugin_rules_get_hidden (SystrayPlugin *plugin,
+                                 SystraySocket *socket)
+{
+  GSList      *li;
+  SystrayRule *rule;
+  const gchar *subject;
+
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin), FALSE);
+  panel_return_val_if_fail (XFCE_IS_SYSTRAY_SOCKET (socket), FALSE);
+
+  for (li = plugin->rules; li != NULL; li = li->next)
+    {
+      rule = li->data;
+
+      /* both properties are cached in the socket */
+      if (rule->match == RULE_MATCH_CLASS)
+        subject = systray_socket_get_class (socket);
+      else
+        subject = systray_socket_get_name (socket);
+
+      if (exo_str_is_empty (subject))
+        continue;
+
+      if (rule->regex != NULL)
+        {
+          if (g_regex_match (rule->regex, subject, 0, NULL))
+            return TRUE;
+        }
+      else if (g_pattern_match_string (rule->spec, subject))
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+
+
 static void
 systray_plugin_names_clear (SystrayPlugin *plugin)
 {
@@ -829,12 +1092,31 @@ systray_plugin_icon_added (SystrayManager *manager,
   gtk_container_add (GTK_CONTAINER (plugin->box), icon);
   gtk_widget_show (icon);
 
+  /* only this icon has to be checked again if its name changes */
+  g_signal_connect (G_OBJECT (icon), "name-changed",
+      G_CALLBACK (systray_plugin_icon_name_changed), plugin);
+
   panel_debug_filtered (PANEL_DEBUG_SYSTRAY, "added %s[%p] icon",
       systray_socket_get_name (XFCE_SYSTRAY_SOCKET (icon)), icon);
 }
 
 
 
+static void
+systray_plugin_icon_name_changed (GtkWidget     *icon,
+                                  SystrayPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_PLUGIN (plugin));
+  panel_return_if_fail (XFCE_IS_SYSTRAY_SOCKET (icon));
+
+  systray_plugin_names_update_icon (icon, plugin);
+
+  /* resort the box */
+  systray_box_update (XFCE_SYSTRAY_BOX (plugin->box));
+}
+
+
+
 static void
 systray_plugin_icon_removed (SystrayManager *manager,
                              GtkWidget      *icon,
@@ -845,6 +1127,9 @@ systray_plugin_icon_removed (SystrayManager *manager,
   panel_return_if_fail (plugin->manager == manager);
   panel_return_if_fail (GTK_IS_WIDGET (icon));
 
+  g_signal_handlers_disconnect_by_func (G_OBJECT (icon),
+      systray_plugin_icon_name_changed, plugin);
+
   /* remove the icon from the box */
   gtk_container_remove (GTK_CONTAINER (plugin->box), icon);
 
@@ -65,6 +65,17 @@ struct _WindowMenuPlugin
   /* urgent window counter */
   gint                urgent_windows;
 
+  /* window model, the entries are bucketed per workspace */
+  GHashTable         *entries;
+  GHashTable         *buckets;
+  guint               stack_counter;
+  guint               stacking_changed : 1;
+
+  /* menu and fonts, reused between popups */
+  GtkWidget          *menu;
+  PangoFontDescription *italic;
+  PangoFontDescription *bold;
+
   /* gtk style properties */
   gint                minimized_icon_lucency;
   PangoEllipsizeMode  ellipsize_mode;
@@ -87,6 +98,22 @@ enum
   BUTTON_STYLE_ARROW
 };
 
+typedef struct
+{
+  WnckWindow    *window;
+
+  /* bucket of the window, NULL for pinned windows */
+  WnckWorkspace *workspace;
+
+  /* position in the stacking order */
+  guint          stack_index;
+
+  /* cached menu item, recreated when dirty */
+  GtkWidget     *mi;
+  guint          dirty : 1;
+}
+WindowMenuEntry;
+
 
 
 static void      window_menu_plugin_get_property            (GObject            *object,
@@ -124,9 +151,11 @@ static void      window_menu_plugin_window_opened           (WnckScreen
 static void      window_menu_plugin_window_closed           (WnckScreen         *screen,
                                                              WnckWindow         *window,
                                                              WindowMenuPlugin   *plugin);
+static void      window_menu_plugin_entry_invalidate        (WindowMenuPlugin   *plugin,
+                                                             WnckWindow         *window);
+static void      window_menu_plugin_urgency_update          (WindowMenuPlugin   *plugin);
 static void      window_menu_plugin_windows_disconnect      (WindowMenuPlugin   *plugin);
-static void      window_menu_plugin_windows_connect         (WindowMenuPlugin   *plugin,
-                                                             gboolean            traverse_windows);
+static void      window_menu_plugin_windows_connect         (WindowMenuPlugin   *plugin);
 static void      window_menu_plugin_menu                    (GtkWidget          *button,
                                                              WindowMenuPlugin   *plugin);
 
@@ -246,6 +275,8 @@ window_menu_plugin_init (WindowMenuPlugin *plugin)
   plugin->minimized_icon_lucency = DEFAULT_ICON_LUCENCY;
   plugin->ellipsize_mode = DEFAULT_ELLIPSIZE_MODE;
   plugin->max_width_chars = DEFAULT_MAX_WIDTH_CHARS;
+  plugin->italic = pango_font_description_from_string ("italic");
+  plugin->bold = pango_font_description_from_string ("bold");
 
   /* create the widgets */
   plugin->button = xfce_arrow_button_new (GTK_ARROW_NONE);
@@ -353,14 +384,9 @@ window_menu_plugin_set_property (GObject      *object,
         {
           plugin->urgentcy_notification = urgentcy_notification;
 
+          /* recount or stop blinking */
           if (plugin->screen != NULL)
-            {
-              /* (dis)connect window signals */
-              if (plugin->urgentcy_notification)
-                window_menu_plugin_windows_connect (plugin, TRUE);
-              else
-                window_menu_plugin_windows_disconnect (plugin);
-            }
+            window_menu_plugin_urgency_update (plugin);
         }
       break;
 
@@ -381,6 +407,8 @@ window_menu_plugin_style_set (GtkWidget *widget,
                               GtkStyle  *previous_style)
 {
   WindowMenuPlugin *plugin = XFCE_WINDOW_MENU_PLUGIN (widget);
+  GHashTableIter    iter;
+  gpointer          entry;
 
   /* let gtk update the widget style */
   (*GTK_WIDGET_CLASS (window_menu_plugin_parent_class)->style_set) (widget, previous_style);
@@ -391,6 +419,14 @@ window_menu_plugin_style_set (GtkWidget *widget,
                         "ellipsize-mode", &plugin->ellipsize_mode,
                         "max-width-chars", &plugin->max_width_chars,
                         NULL);
+
+  /* the cached menu items use these properties */
+  if (plugin->entries != NULL)
+    {
+      g_hash_table_iter_init (&iter, plugin->entries);
+      while (g_hash_table_iter_next (&iter, NULL, &entry))
+        ((WindowMenuEntry *) entry)->dirty = TRUE;
+    }
 }
 
 
@@ -430,8 +466,8 @@ window_menu_plugin_screen_changed (GtkWidget *widget,
   g_signal_connect (G_OBJECT (plugin->screen), "active-window-changed",
       G_CALLBACK (window_menu_plugin_active_window_changed), plugin);
 
-  if (plugin->urgentcy_notification)
-     window_menu_plugin_windows_connect (plugin, FALSE);
+  /* build the window model */
+  window_menu_plugin_windows_connect (plugin);
 }
 
 
@@ -492,6 +528,12 @@ window_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
 
       plugin->screen = NULL;
     }
+
+  if (plugin->menu != NULL)
+    gtk_widget_destroy (plugin->menu);
+
+  pango_font_description_free (plugin->italic);
+  pango_font_description_free (plugin->bold);
 }
 
 
@@ -625,6 +667,10 @@ window_menu_plugin_active_window_changed (WnckScreen       *screen,
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (plugin->screen == screen);
 
+  /* the active window has an italic label */
+  window_menu_plugin_entry_invalidate (plugin, previous_window);
+  window_menu_plugin_entry_invalidate (plugin, wnck_screen_get_active_window (screen));
+
   /* only do this when the icon is visible */
   if (plugin->button_style == BUTTON_STYLE_ICON)
     {
@@ -659,6 +705,152 @@ window_menu_plugin_active_window_changed (WnckScreen       *screen,
 
 
 
+static void
+window_menu_plugin_entry_free (gpointer data)
+{
+  WindowMenuEntry *entry = data;
+
+  if (entry->mi != NULL)
+    {
+      gtk_widget_destroy (entry->mi);
+      g_object_unref (G_OBJECT (entry->mi));
+    }
+
+  g_slice_free (WindowMenuEntry, entry);
+}
+
+
+
+static void
+window_menu_plugin_entry_invalidate (WindowMenuPlugin *plugin,
+                                     WnckWindow       *window)
+{
+  WindowMenuEntry *entry;
+
+  if (window == NULL || plugin->entries == NULL)
+    return;
+
+  /* the menu item is recreated on the next popup */
+  entry = g_hash_table_lookup (plugin->entries, window);
+  if (G_LIKELY (entry != NULL))
+    entry->dirty = TRUE;
+}
+
+
+
+static void
+window_menu_plugin_bucket_add (WindowMenuPlugin *plugin,
+                               WindowMenuEntry  *entry)
+{
+  GQueue *bucket;
+
+  bucket = g_hash_table_lookup (plugin->buckets, entry->workspace);
+  if (bucket == NULL)
+    {
+      bucket = g_queue_new ();
+      g_hash_table_insert (plugin->buckets, entry->workspace, bucket);
+    }
+
+  g_queue_push_tail (bucket, entry);
+}
+
+
+
+static void
+window_menu_plugin_bucket_remove (WindowMenuPlugin *plugin,
+                                  WindowMenuEntry  *entry)
+{
+  GQueue *bucket;
+
+  bucket = g_hash_table_lookup (plugin->buckets, entry->workspace);
+  if (G_UNLIKELY (bucket == NULL))
+    return;
+
+  g_queue_remove (bucket, entry);
+  if (g_queue_is_empty (bucket))
+    g_hash_table_remove (plugin->buckets, entry->workspace);
+}
+
+
+
+static void
+window_menu_plugin_buckets_restack (WindowMenuPlugin *plugin)
+{
+  GList           *windows, *li;
+  WindowMenuEntry *entry;
+  guint            stack_index = 0;
+
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->screen));
+
+  /* refill the buckets in stacking order */
+  g_hash_table_remove_all (plugin->buckets);
+
+  windows = wnck_screen_get_windows_stacked (plugin->screen);
+  for (li = windows; li != NULL; li = li->next)
+    {
+      entry = g_hash_table_lookup (plugin->entries, li->data);
+      if (G_UNLIKELY (entry == NULL))
+        continue;
+
+      entry->stack_index = stack_index++;
+      window_menu_plugin_bucket_add (plugin, entry);
+    }
+
+  plugin->stack_counter = stack_index;
+  plugin->stacking_changed = FALSE;
+}
+
+
+
+static void
+window_menu_plugin_stacking_changed (WnckScreen       *screen,
+                                     WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+
+  /* the buckets are resorted on the next popup */
+  plugin->stacking_changed = TRUE;
+}
+
+
+
+static void
+window_menu_plugin_window_changed (WnckWindow       *window,
+                                   WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+
+  /* name or icon changed */
+  window_menu_plugin_entry_invalidate (plugin, window);
+}
+
+
+
+static void
+window_menu_plugin_window_workspace_changed (WnckWindow       *window,
+                                             WindowMenuPlugin *plugin)
+{
+  WindowMenuEntry *entry;
+
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+
+  entry = g_hash_table_lookup (plugin->entries, window);
+  if (G_UNLIKELY (entry == NULL))
+    return;
+
+  /* move the window to its new bucket, the position
+   * in the stacking order is fixed on the next popup */
+  window_menu_plugin_bucket_remove (plugin, entry);
+  entry->workspace = wnck_window_get_workspace (window);
+  window_menu_plugin_bucket_add (plugin, entry);
+
+  plugin->stacking_changed = TRUE;
+}
+
+
+
 static void
 window_menu_plugin_window_state_changed (WnckWindow       *window,
                                          WnckWindowState   changed_mask,
@@ -667,11 +859,13 @@ window_menu_plugin_window_state_changed (WnckWindow       *window,
 {
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (WNCK_IS_WINDOW (window));
-  panel_return_if_fail (plugin->urgentcy_notification);
-  panel_return_if_fail (plugin->urgentcy_notification);
+
+  /* the label and icon of the item depend on the state */
+  window_menu_plugin_entry_invalidate (plugin, window);
 
   /* only response to urgency changes and urgency notify is enabled */
-  if (!PANEL_HAS_FLAG (changed_mask, URGENT_FLAGS))
+  if (!plugin->urgentcy_notification
+      || !PANEL_HAS_FLAG (changed_mask, URGENT_FLAGS))
     return;
 
   /* update the blinking state */
@@ -689,20 +883,60 @@ window_menu_plugin_window_state_changed (WnckWindow       *window,
 
 
 
+static void
+window_menu_plugin_urgency_update (WindowMenuPlugin *plugin)
+{
+  GHashTableIter iter;
+  gpointer       window;
+
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+
+  /* recount the urgent windows from the model */
+  plugin->urgent_windows = 0;
+  if (plugin->urgentcy_notification
+      && plugin->entries != NULL)
+    {
+      g_hash_table_iter_init (&iter, plugin->entries);
+      while (g_hash_table_iter_next (&iter, &window, NULL))
+        if (wnck_window_needs_attention (WNCK_WINDOW (window)))
+          plugin->urgent_windows++;
+    }
+
+  xfce_arrow_button_set_blinking (XFCE_ARROW_BUTTON (plugin->button),
+                                  plugin->urgent_windows > 0);
+}
+
+
+
 static void
 window_menu_plugin_window_opened (WnckScreen       *screen,
                                   WnckWindow       *window,
                                   WindowMenuPlugin *plugin)
 {
+  WindowMenuEntry *entry;
+
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (WNCK_IS_WINDOW (window));
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (plugin->screen == screen);
-  panel_return_if_fail (plugin->urgentcy_notification);
+
+  /* add the window on top of its bucket */
+  entry = g_slice_new0 (WindowMenuEntry);
+  entry->window = window;
+  entry->workspace = wnck_window_get_workspace (window);
+  entry->stack_index = plugin->stack_counter++;
+  g_hash_table_insert (plugin->entries, window, entry);
+  window_menu_plugin_bucket_add (plugin, entry);
 
   /* monitor the window's state */
   g_signal_connect (G_OBJECT (window), "state-changed",
       G_CALLBACK (window_menu_plugin_window_state_changed), plugin);
+  g_signal_connect (G_OBJECT (window), "workspace-changed",
+      G_CALLBACK (window_menu_plugin_window_workspace_changed), plugin);
+  g_signal_connect (G_OBJECT (window), "name-changed",
+      G_CALLBACK (window_menu_plugin_window_changed), plugin);
+  g_signal_connect (G_OBJECT (window), "icon-changed",
+      G_CALLBACK (window_menu_plugin_window_changed), plugin);
 
   /* check if the window needs attention */
   if (wnck_window_needs_attention (window))
@@ -717,16 +951,29 @@ window_menu_plugin_window_closed (WnckScreen       *screen,
                                   WnckWindow       *window,
                                   WindowMenuPlugin *plugin)
 {
+  WindowMenuEntry *entry;
+
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (WNCK_IS_WINDOW (window));
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (plugin->screen == screen);
-  panel_return_if_fail (plugin->urgentcy_notification);
 
   /* check if we need to update the urgency counter */
   if (wnck_window_needs_attention (window))
     window_menu_plugin_window_state_changed (window, URGENT_FLAGS,
                                              0, plugin);
+
+  g_signal_handlers_disconnect_matched (G_OBJECT (window), G_SIGNAL_MATCH_DATA,
+                                        0, 0, NULL, NULL, plugin);
+
+  /* drop the window from the model, this also
+   * removes its item from the (visible) menu */
+  entry = g_hash_table_lookup (plugin->entries, window);
+  if (G_LIKELY (entry != NULL))
+    {
+      window_menu_plugin_bucket_remove (plugin, entry);
+      g_hash_table_remove (plugin->entries, window);
+    }
 }
 
 
@@ -744,14 +991,29 @@ window_menu_plugin_windows_disconnect (WindowMenuPlugin *plugin)
      window_menu_plugin_window_closed, plugin);
   g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
      window_menu_plugin_window_opened, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
+     window_menu_plugin_stacking_changed, plugin);
 
-  /* disconnect the state changed signal from all windows */
+  /* disconnect the signals from all windows */
   windows = wnck_screen_get_windows (plugin->screen);
   for (li = windows; li != NULL; li = li->next)
     {
       panel_return_if_fail (WNCK_IS_WINDOW (li->data));
-      g_signal_handlers_disconnect_by_func (G_OBJECT (li->data),
-          window_menu_plugin_window_state_changed, plugin);
+      g_signal_handlers_disconnect_matched (G_OBJECT (li->data), G_SIGNAL_MATCH_DATA,
+                                            0, 0, NULL, NULL, plugin);
+    }
+
+  /* clear the model */
+  if (plugin->buckets != NULL)
+    {
+      g_hash_table_destroy (plugin->buckets);
+      plugin->buckets = NULL;
+    }
+
+  if (plugin->entries != NULL)
+    {
+      g_hash_table_destroy (plugin->entries);
+      plugin->entries = NULL;
     }
 
   /* stop blinking */
@@ -762,24 +1024,28 @@ window_menu_plugin_windows_disconnect (WindowMenuPlugin *plugin)
 
 
 static void
-window_menu_plugin_windows_connect (WindowMenuPlugin *plugin,
-                                    gboolean          traverse_windows)
+window_menu_plugin_windows_connect (WindowMenuPlugin *plugin)
 {
   GList *windows, *li;
 
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (WNCK_IS_SCREEN (plugin->screen));
-  panel_return_if_fail (plugin->urgentcy_notification);
+  panel_return_if_fail (plugin->entries == NULL);
+
+  plugin->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, window_menu_plugin_entry_free);
+  plugin->buckets = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) g_queue_free);
+  plugin->stack_counter = 0;
 
   g_signal_connect (G_OBJECT (plugin->screen), "window-opened",
       G_CALLBACK (window_menu_plugin_window_opened), plugin);
   g_signal_connect (G_OBJECT (plugin->screen), "window-closed",
       G_CALLBACK (window_menu_plugin_window_closed), plugin);
+  g_signal_connect (G_OBJECT (plugin->screen), "window-stacking-changed",
+      G_CALLBACK (window_menu_plugin_stacking_changed), plugin);
 
-  if (!traverse_windows)
-    return;
-
-  /* connect the state changed signal to all windows */
+  /* add the windows the screen already knows about */
   windows = wnck_screen_get_windows (plugin->screen);
   for (li = windows; li != NULL; li = li->next)
     {
@@ -788,6 +1054,9 @@ window_menu_plugin_windows_connect (WindowMenuPlugin *plugin,
                                         WNCK_WINDOW (li->data),
                                         plugin);
     }
+
+  /* that list is not in stacking order */
+  plugin->stacking_changed = TRUE;
 }
 
 
@@ -1051,9 +1320,6 @@ window_menu_plugin_menu_selection_done (GtkWidget *menu,
 
   if (button != NULL)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), FALSE);
-
-  /* delay destruction so we can handle the activate event first */
-  exo_gtk_object_destroy_later (GTK_OBJECT (menu));
 }
 
 
@@ -1126,15 +1392,45 @@ window_menu_plugin_menu_key_press_event (GtkWidget   *menu,
 
 
 static GtkWidget *
-window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
+window_menu_plugin_menu_entry_item (WindowMenuPlugin *plugin,
+                                    WindowMenuEntry  *entry,
+                                    gint              icon_w,
+                                    gint              icon_h)
 {
-  GtkWidget            *menu, *mi = NULL, *image;
+  /* drop the outdated item */
+  if (entry->mi != NULL && entry->dirty)
+    {
+      gtk_widget_destroy (entry->mi);
+      g_object_unref (G_OBJECT (entry->mi));
+      entry->mi = NULL;
+    }
+
+  if (entry->mi == NULL)
+    {
+      entry->mi = window_menu_plugin_menu_window_item_new (entry->window, plugin,
+          plugin->italic, plugin->bold, icon_w, icon_h);
+      g_object_ref_sink (G_OBJECT (entry->mi));
+      gtk_widget_show (entry->mi);
+      entry->dirty = FALSE;
+    }
+
+  return entry->mi;
+}
+
+
+
+static void
+window_menu_plugin_menu_update (WindowMenuPlugin *plugin)
+{
+  GtkWidget            *menu = plugin->menu;
+  GtkWidget            *mi = NULL, *image;
   GList                *workspaces, *lp, fake;
-  GList                *windows, *li;
+  GList                *children, *li;
+  GList                *a, *b;
+  GQueue               *bucket, *pinned;
   WnckWorkspace        *workspace = NULL;
-  WnckWorkspace        *active_workspace, *window_workspace;
-  WnckWindow           *window;
-  PangoFontDescription *italic, *bold;
+  WnckWorkspace        *active_workspace;
+  WindowMenuEntry      *entry;
   gint                  urgent_windows = 0;
   gboolean              has_windows;
   gboolean              is_empty = TRUE;
@@ -1143,21 +1439,28 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
   gchar                *utf8 = NULL, *label;
   gint                  w, h;
 
-  panel_return_val_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin), NULL);
-  panel_return_val_if_fail (WNCK_IS_SCREEN (plugin->screen), NULL);
-
-  italic = pango_font_description_from_string ("italic");
-  bold = pango_font_description_from_string ("bold");
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->screen));
+  panel_return_if_fail (GTK_IS_MENU (menu));
 
   if (!gtk_icon_size_lookup (menu_icon_size, &w, &h))
     w = h = 16;
 
-  menu = gtk_menu_new ();
-  g_signal_connect (G_OBJECT (menu), "key-press-event",
-      G_CALLBACK (window_menu_plugin_menu_key_press_event), plugin);
+  /* take the cached window items out of the menu, the
+   * other items are cheap and created again */
+  children = gtk_container_get_children (GTK_CONTAINER (menu));
+  for (li = children; li != NULL; li = li->next)
+    {
+      if (g_object_get_qdata (G_OBJECT (li->data), window_quark) != NULL)
+        gtk_container_remove (GTK_CONTAINER (menu), GTK_WIDGET (li->data));
+      else
+        gtk_widget_destroy (GTK_WIDGET (li->data));
+    }
+  g_list_free (children);
+
+  if (plugin->stacking_changed)
+    window_menu_plugin_buckets_restack (plugin);
 
-  /* get all the windows and the active workspace */
-  windows = wnck_screen_get_windows_stacked (plugin->screen);
   active_workspace = wnck_screen_get_active_workspace (plugin->screen);
 
   if (plugin->all_workspaces)
@@ -1181,7 +1484,7 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
         {
           /* create the workspace menu item */
           mi = window_menu_plugin_menu_workspace_item_new (workspace, plugin,
-              workspace == active_workspace ? bold : italic);
+              workspace == active_workspace ? plugin->bold : plugin->italic);
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
           gtk_widget_show (mi);
 
@@ -1193,29 +1496,39 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
           is_empty = FALSE;
         }
 
-      for (li = windows, has_windows = FALSE; li != NULL; li = li->next)
-        {
-          window = WNCK_WINDOW (li->data);
+      /* windows from this workspace, merged with the pinned
+       * windows on the active workspace in stacking order */
+      bucket = g_hash_table_lookup (plugin->buckets, workspace);
+      pinned = NULL;
+      if (workspace == active_workspace && workspace != NULL)
+        pinned = g_hash_table_lookup (plugin->buckets, NULL);
 
-          /* windows we always want to skip */
-          if (wnck_window_is_skip_pager (window)
-              || wnck_window_is_skip_tasklist (window))
-            continue;
+      a = bucket != NULL ? bucket->head : NULL;
+      b = pinned != NULL ? pinned->head : NULL;
 
-          /* get the window's workspace */
-          window_workspace = wnck_window_get_workspace (window);
+      for (has_windows = FALSE; a != NULL || b != NULL;)
+        {
+          if (b == NULL
+              || (a != NULL
+                  && ((WindowMenuEntry *) a->data)->stack_index
+                     < ((WindowMenuEntry *) b->data)->stack_index))
+            {
+              entry = a->data;
+              a = a->next;
+            }
+          else
+            {
+              entry = b->data;
+              b = b->next;
+            }
 
-          /* show only windows from this workspace or pinned
-           * windows on the active workspace */
-          if (window_workspace != workspace
-              && !(window_workspace == NULL
-                   && workspace == active_workspace))
+          /* windows we always want to skip */
+          if (wnck_window_is_skip_pager (entry->window)
+              || wnck_window_is_skip_tasklist (entry->window))
             continue;
 
-          /* create the menu item */
-          mi = window_menu_plugin_menu_window_item_new (window, plugin, italic, bold, w, h);
+          mi = window_menu_plugin_menu_entry_item (plugin, entry, w, h);
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
-          gtk_widget_show (mi);
 
           /* this workspace is not empty */
           has_windows = TRUE;
@@ -1224,7 +1537,7 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
           is_empty = FALSE;
 
           /* count the urgent windows */
-          if (wnck_window_needs_attention (window))
+          if (wnck_window_needs_attention (entry->window))
             urgent_windows++;
         }
 
@@ -1268,29 +1581,29 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
       gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
       gtk_widget_show (mi);
 
-      for (li = windows; li != NULL; li = li->next)
+      /* only the buckets of the other workspaces */
+      for (lp = wnck_screen_get_workspaces (plugin->screen); lp != NULL; lp = lp->next)
         {
-          window = WNCK_WINDOW (li->data);
+          if (lp->data == active_workspace)
+            continue;
 
-          /* always skip these windows */
-          if (wnck_window_is_skip_pager (window)
-              || wnck_window_is_skip_tasklist (window))
+          bucket = g_hash_table_lookup (plugin->buckets, lp->data);
+          if (bucket == NULL)
             continue;
 
-          /* get the window's workspace */
-          window_workspace = wnck_window_get_workspace (window);
+          for (a = bucket->head; a != NULL; a = a->next)
+            {
+              entry = a->data;
 
-          /* only acept windows that are not on the active workspace,
-           * not sticky and urgent */
-          if (window_workspace == active_workspace
-              || window_workspace == NULL
-              || !wnck_window_needs_attention (window))
-            continue;
+              /* always skip these windows and only accept urgent ones */
+              if (wnck_window_is_skip_pager (entry->window)
+                  || wnck_window_is_skip_tasklist (entry->window)
+                  || !wnck_window_needs_attention (entry->window))
+                continue;
 
-          /* create the menu item */
-          mi = window_menu_plugin_menu_window_item_new (window, plugin, italic, bold, w, h);
-          gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
-          gtk_widget_show (mi);
+              mi = window_menu_plugin_menu_entry_item (plugin, entry, w, h);
+              gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
+            }
         }
     }
 
@@ -1338,11 +1651,6 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
       gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (mi), image);
       gtk_widget_show (mi);
     }
-
-  pango_font_description_free (italic);
-  pango_font_description_free (bold);
-
-  return menu;
 }
 
 
@@ -1351,8 +1659,6 @@ static void
 window_menu_plugin_menu (GtkWidget        *button,
                          WindowMenuPlugin *plugin)
 {
-  GtkWidget *menu;
-
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (button == NULL || plugin->button == button);
 
@@ -1360,12 +1666,22 @@ window_menu_plugin_menu (GtkWidget        *button,
       && !gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button)))
     return;
 
+  /* the menu is kept between popups */
+  if (plugin->menu == NULL)
+    {
+      plugin->menu = gtk_menu_new ();
+      g_signal_connect (G_OBJECT (plugin->menu), "key-press-event",
+          G_CALLBACK (window_menu_plugin_menu_key_press_event), plugin);
+      g_signal_connect (G_OBJECT (plugin->menu), "deactivate",
+          G_CALLBACK (window_menu_plugin_menu_selection_done), plugin->button);
+      g_signal_connect (G_OBJECT (plugin->menu), "destroy",
+          G_CALLBACK (gtk_widget_destroyed), &plugin->menu);
+    }
+
   /* popup the menu */
-  menu = window_menu_plugin_menu_new (plugin);
-  g_signal_connect (G_OBJECT (menu), "deactivate",
-      G_CALLBACK (window_menu_plugin_menu_selection_done), button);
+  window_menu_plugin_menu_update (plugin);
 
-  gtk_menu_popup (GTK_MENU (menu), NULL, NULL,
+  gtk_menu_popup (GTK_MENU (plugin->menu), NULL, NULL,
                   button != NULL ? xfce_panel_plugin_position_menu : NULL,
                   plugin, 1, gtk_get_current_event_time ());
 }
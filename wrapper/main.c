@@ -277,6 +277,13 @@ main (gint argc, gchar **argv)
   const gchar             *comment;
   gchar                  **arguments;
 
+#if !GLIB_CHECK_VERSION (2, 32, 0)
+  /* initialize the threading system, plugins like the applications
+   * menu parse files in a worker thread */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+#endif
+
   /* set translation domain */
   xfce_textdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR, "UTF-8");
 